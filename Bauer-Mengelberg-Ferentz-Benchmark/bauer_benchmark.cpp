@@ -0,0 +1,539 @@
+/*
+* File: bauer_benchmark.cpp
+* Author: Jeff Martin
+* This file contains the main() function for the benchmark. It times each
+* generator end to end, runs each search engine with a counting predicate to
+* find the time per node, times each predicate on a fixed set of candidate
+* rows, each next* step function and each writer, and writes the results to
+* a JSON file so that two builds can be compared. It also checks that each
+* parallel search finds the same rows as the serial search and tests no
+* more permutations, and exits with 1 if not. On Linux the peak memory of
+* each generator is its own, since the peak of the process is reset before
+* each generator runs. Elsewhere only the peak of the whole process is
+* reported.
+*
+* Usage: Bauer-Mengelberg-Ferentz-Benchmark [results.json] [scratch directory]
+*
+* Copyright  2022 by Jeffrey Martin. All rights reserved.
+* Email: jmartin@jeffreymartincomposer.com
+* Website: https://jeffreymartincomposer.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+#include "bauer_algorithm.h"
+#include "bauer_backtrack.h"
+#include "bauer_fused.h"
+#include "bauer_meet.h"
+#include "bauer_trichord.h"
+#include "bauer_trichord_ten.h"
+#include "bauer_trichord_babbitt.h"
+
+// each measurement is repeated and the fastest time is kept
+const int REPEATS = 3;
+
+// the number of candidate rows for the predicates, and of rows for the writers
+const int CANDIDATES = 200000;
+const int WRITTEN_ROWS = 1000000;
+
+/// <summary>
+/// Wraps a predicate and counts how many times it is called
+/// </summary>
+template <typename Predicate>
+struct CountingPredicate
+{
+	Predicate isValid;
+	uint64_t calls;
+
+	CountingPredicate(const Predicate& isValid) : isValid(isValid), calls(0) {}
+
+	int operator()(int* permutation, int from)
+	{
+		calls++;
+		return isValid(permutation, from);
+	}
+};
+
+/// <summary>
+/// Wraps a predicate and counts how many times any of its copies is called
+/// </summary>
+template <typename Predicate>
+struct SharedCountingPredicate
+{
+	Predicate isValid;
+	std::atomic<uint64_t>* calls;
+
+	SharedCountingPredicate(const Predicate& isValid, std::atomic<uint64_t>& calls) : isValid(isValid), calls(&calls) {}
+
+	int operator()(int* permutation, int from)
+	{
+		calls->fetch_add(1, std::memory_order_relaxed);
+		return isValid(permutation, from);
+	}
+};
+
+/// <summary>
+/// One row of the results
+/// </summary>
+struct BenchmarkResult
+{
+	std::string name;
+	double ms;
+
+	// the units of work done: rows found, nodes, calls, steps or rows written
+	uint64_t rows;
+	uint64_t nodes;
+
+	// the most memory held at once while it ran, or 0 if that is not known
+	uint64_t peakKilobytes;
+};
+
+static std::vector<std::vector<int>> makeCandidates(int length, int first, bool fixFirst, int count);
+static uint64_t peakMemoryKilobytes();
+static bool resetPeakMemory();
+static double timeBest(const std::function<void()>& run);
+static void writeResultGroup(std::ostream& out, const char* name, const std::vector<BenchmarkResult>& results, const char* rowsName, const char* nodesName, const char* perNodeName);
+static void writeResults(std::string path, uint64_t peakKilobytes, const std::vector<BenchmarkResult>& generators, const std::vector<BenchmarkResult>& engines,
+	const std::vector<BenchmarkResult>& predicates, const std::vector<BenchmarkResult>& steps, const std::vector<BenchmarkResult>& writers);
+
+/// <summary>
+/// Runs the skip-ahead enumerator with a counting predicate until the end condition holds
+/// </summary>
+/// <typeparam name="Length">The number of digits in the permutation</typeparam>
+/// <typeparam name="First">The smallest digit in the permutation</typeparam>
+/// <param name="name">The name of the result</param>
+/// <param name="isValid">The predicate</param>
+/// <param name="finished">True once the permutation is past the end of the search</param>
+/// <returns>The result</returns>
+template <int Length, int First, typename Predicate>
+static BenchmarkResult benchmarkEngine(std::string name, const Predicate& isValid, const std::function<bool(const int*)>& finished)
+{
+	BenchmarkResult result = { name, 0, 0, 0, 0 };
+	result.ms = timeBest([&]()
+	{
+		int permutation[Length];
+		for (int i = 0; i < Length; i++)
+			permutation[i] = First + i;
+		CountingPredicate<Predicate> counted(isValid);
+		RowCounter counter;
+		nextRow<Length, First>(permutation, counted);
+		while (!finished(permutation))
+		{
+			counter.write(permutation);
+			nextRow<Length, First>(permutation, counted);
+		}
+		result.rows = counter.count();
+		result.nodes = counted.calls;
+	});
+	return result;
+}
+
+/// <summary>
+/// Checks that the parallel search finds the rows the serial search found, and tests no
+/// more permutations than it
+/// </summary>
+/// <typeparam name="Length">The number of digits in the permutation</typeparam>
+/// <typeparam name="First">The smallest digit in the permutation</typeparam>
+/// <param name="serial">The result of the serial search</param>
+/// <param name="isValid">The predicate</param>
+/// <param name="endPrefix">The first prefix the search does not cover</param>
+/// <param name="endLength">The number of digits in the end prefix</param>
+/// <returns>True if every thread count passed</returns>
+template <int Length, int First, typename Predicate>
+static bool checkParallelEngine(const BenchmarkResult& serial, const Predicate& isValid, const int* endPrefix, int endLength)
+{
+	bool passed = true;
+	const unsigned int threadCounts[3] = { 2, 4, 64 };
+	for (unsigned int threads : threadCounts)
+	{
+		std::atomic<uint64_t> calls(0);
+		RowCounter counter;
+		searchParallel<Length, First>(SharedCountingPredicate<Predicate>(isValid, calls), endPrefix, endLength, threads, counter);
+		if (counter.count() != serial.rows || calls > serial.nodes)
+		{
+			std::cerr << "The parallel " << serial.name << " search with " << threads << " threads found " << counter.count() << " rows in "
+				<< calls << " tests, against " << serial.rows << " rows in " << serial.nodes << " tests for the serial search.\n";
+			passed = false;
+		}
+	}
+	return passed;
+}
+
+/// <summary>
+/// Calls a predicate on every candidate row
+/// </summary>
+/// <param name="name">The name of the result</param>
+/// <param name="candidates">The candidate rows</param>
+/// <param name="isValid">The predicate, which returns -1 for a valid row</param>
+/// <returns>The result, with the number of valid candidates as the rows</returns>
+static BenchmarkResult benchmarkPredicate(std::string name, std::vector<std::vector<int>>& candidates, const std::function<int(int*)>& isValid)
+{
+	BenchmarkResult result = { name, 0, 0, candidates.size(), 0 };
+	result.ms = timeBest([&]()
+	{
+		uint64_t valid = 0;
+		for (size_t i = 0; i < candidates.size(); i++)
+		{
+			if (isValid(candidates[i].data()) == -1)
+				valid++;
+		}
+		result.rows = valid;
+	});
+	return result;
+}
+
+/// <summary>
+/// Calls a step function until the end condition holds
+/// </summary>
+/// <param name="name">The name of the result</param>
+/// <param name="start">The starting permutation</param>
+/// <param name="step">The step function</param>
+/// <param name="finished">True once the permutation is past the end of the search</param>
+/// <returns>The result, with the number of steps as the nodes</returns>
+static BenchmarkResult benchmarkSteps(std::string name, std::vector<int> start, const std::function<void(int*)>& step, const std::function<bool(const int*)>& finished)
+{
+	BenchmarkResult result = { name, 0, 0, 0, 0 };
+	result.ms = timeBest([&]()
+	{
+		std::vector<int> permutation = start;
+		uint64_t steps = 0;
+		do
+		{
+			step(permutation.data());
+			steps++;
+		} while (!finished(permutation.data()));
+		result.rows = steps - 1;
+		result.nodes = steps;
+	});
+	return result;
+}
+
+/// <summary>
+/// Times a writer given the same set of rows over and over
+/// </summary>
+/// <param name="name">The name of the result</param>
+/// <param name="write">Creates the sink, writes the rows and closes it</param>
+/// <returns>The result</returns>
+static BenchmarkResult benchmarkWriter(std::string name, const std::function<void()>& write)
+{
+	BenchmarkResult result = { name, 0, WRITTEN_ROWS, WRITTEN_ROWS, 0 };
+	result.ms = timeBest(write);
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	std::string resultsFile = argc > 1 ? argv[1] : "benchmark.json";
+	std::string scratch = argc > 2 ? std::string(argv[2]) + "/" : "";
+	int trichordTable[12][12];
+	loadIntervalTable(trichordTable);
+
+	// end to end, including the output files
+	std::vector<BenchmarkResult> generators;
+	uint64_t peakKilobytes = 0;
+	std::vector<std::pair<std::string, std::function<void(std::string)>>> runs =
+	{
+		{ "allInterval", [](std::string path) { generateAllIntervalRowGenerators(path); } },
+		{ "allIntervalParallel", [](std::string path) { generateAllIntervalRowGenerators(path, 0); } },
+		{ "allIntervalBacktracking", [](std::string path) { generateAllIntervalRowGeneratorsBacktracking(path); } },
+		{ "allIntervalMeetInTheMiddle", [](std::string path) { generateIntervalRowGeneratorsMeetInTheMiddle(path, 12); } },
+		{ "allTrichord", [](std::string path) { generateAllTrichordRows(path); } },
+		{ "allTrichordParallel", [](std::string path) { generateAllTrichordRows(path, 0); } },
+		{ "allTrichordByJoin", [](std::string path) { generateAllTrichordRowsByJoin(path); } },
+		{ "allTrichordBatched", [](std::string path) { generateAllTrichordRowsBatched(path); } },
+		{ "babbitt", [](std::string path) { generateBabbittAllTrichordRows(path); } },
+		{ "babbittParallel", [](std::string path) { generateBabbittAllTrichordRows(path, 0); } },
+		{ "babbittByJoin", [](std::string path) { generateBabbittAllTrichordRowsByJoin(path); } },
+		{ "tenTrichord", [](std::string path) { generateTenTrichordRows(path); } },
+		{ "tenTrichordParallel", [](std::string path) { generateTenTrichordRows(path, 0); } },
+		{ "tenTrichordByJoin", [](std::string path) { generateTenTrichordRowsByJoin(path); } },
+		{ "trichordFused", [](std::string path) { generateTrichordRowsFused(path + ".all", path + ".babbitt", path + ".ten"); } }
+	};
+	for (size_t i = 0; i < runs.size(); i++)
+	{
+		std::string path = scratch + "benchmark_" + runs[i].first + ".json";
+		peakKilobytes = std::max(peakKilobytes, peakMemoryKilobytes());
+		bool reset = resetPeakMemory();
+		BenchmarkResult result = { runs[i].first, timeBest([&]() { runs[i].second(path); }), 0, 0, 0 };
+		if (reset)
+			result.peakKilobytes = peakMemoryKilobytes();
+		generators.push_back(result);
+
+		// the output, the files of the fused search, and the statistics of an instrumented build
+		const char* outputs[4] = { "", ".all", ".babbitt", ".ten" };
+		for (const char* output : outputs)
+		{
+			std::remove((path + output).c_str());
+			std::remove((path + output + ".stats.json").c_str());
+		}
+	}
+
+	// the serial searches, without the output files, for the time per node
+	std::vector<BenchmarkResult> engines;
+	engines.push_back(benchmarkEngine<11, 1>("allInterval", AllIntervalPredicate(), [](const int* permutation) { return permutation[0] >= 6; }));
+	engines.push_back(benchmarkEngine<12, 0>("allTrichord", TrichordRowPredicate(TRICHORD_TABLE), [](const int* permutation) { return permutation[1] >= 6; }));
+	engines.push_back(benchmarkEngine<12, 0>("babbitt", BabbittTrichordRowPredicate(TRICHORD_TABLE), [](const int* permutation) { return permutation[1] >= 6 && permutation[2] >= 6; }));
+	engines.push_back(benchmarkEngine<12, 0>("tenTrichord", TenTrichordRowPredicate(TRICHORD_TABLE), [](const int* permutation) { return permutation[1] >= 6 && permutation[2] >= 6; }));
+
+	// the parallel searches over the same ranges
+	const int intervalEnd[1] = { 6 };
+	const int trichordEnd[2] = { 0, 6 };
+	const int tenTrichordEnd[3] = { 0, 6, 7 };
+	bool passed = checkParallelEngine<11, 1>(engines[0], AllIntervalPredicate(), intervalEnd, 1);
+	passed = checkParallelEngine<12, 0>(engines[1], TrichordRowPredicate(TRICHORD_TABLE), trichordEnd, 2) && passed;
+	passed = checkParallelEngine<12, 0>(engines[2], BabbittTrichordRowPredicate(TRICHORD_TABLE), tenTrichordEnd, 3) && passed;
+	passed = checkParallelEngine<12, 0>(engines[3], TenTrichordRowPredicate(TRICHORD_TABLE), tenTrichordEnd, 3) && passed;
+
+	// the full predicates on random candidates
+	std::vector<std::vector<int>> intervalCandidates = makeCandidates(11, 1, false, CANDIDATES);
+	std::vector<std::vector<int>> rowCandidates = makeCandidates(12, 0, true, CANDIDATES);
+	std::vector<BenchmarkResult> predicates;
+	predicates.push_back(benchmarkPredicate("isValidPermutation", intervalCandidates, [](int* row) { return isValidPermutation(row); }));
+	predicates.push_back(benchmarkPredicate("isValidTrichordRow", rowCandidates, [&](int* row) { return isValidTrichordRow(row, trichordTable); }));
+	predicates.push_back(benchmarkPredicate("isValidTenTrichordRow", rowCandidates, [&](int* row) { return isValidTenTrichordRow(row, trichordTable); }));
+	predicates.push_back(benchmarkPredicate("isValidBabbittTrichordRow", rowCandidates, [&](int* row) { return isValidBabbittTrichordRow(row, trichordTable); }));
+
+	// the step functions, from the first permutation to the end of each search
+	std::vector<BenchmarkResult> steps;
+	std::vector<int> firstIntervals = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+	std::vector<int> firstRow = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+	steps.push_back(benchmarkSteps("nextPermutation", firstIntervals, [](int* permutation) { nextPermutation(permutation); },
+		[](const int* permutation) { return permutation[0] >= 6; }));
+	steps.push_back(benchmarkSteps("nextTrichordRow", firstRow, [&](int* permutation) { nextTrichordRow(permutation); },
+		[](const int* permutation) { return permutation[1] >= 6; }));
+	steps.push_back(benchmarkSteps("nextTenTrichordRow", firstRow, [&](int* permutation) { nextTenTrichordRow(permutation); },
+		[](const int* permutation) { return permutation[1] >= 6 && permutation[2] >= 6; }));
+	steps.push_back(benchmarkSteps("nextBabbittTrichordRow", firstRow, [&](int* permutation) { nextBabbittTrichordRow(permutation); },
+		[](const int* permutation) { return permutation[1] >= 6 && permutation[2] >= 6; }));
+
+	// the writers, each given the candidate rows over and over
+	std::vector<BenchmarkResult> writers;
+	std::string jsonPath = scratch + "benchmark_writer.json";
+	std::string binaryPath = scratch + "benchmark_writer.bin";
+	writers.push_back(benchmarkWriter("JsonRowWriter", [&]()
+	{
+		JsonRowWriter writer(jsonPath, "rows", 12);
+		for (int i = 0; i < WRITTEN_ROWS; i++)
+			writer.write(rowCandidates[i % CANDIDATES].data());
+		writer.close();
+	}));
+	writers.push_back(benchmarkWriter("BinaryRowWriter", [&]()
+	{
+		BinaryRowWriter writer(binaryPath, "rows", 12, 12);
+		for (int i = 0; i < WRITTEN_ROWS; i++)
+			writer.write(rowCandidates[i % CANDIDATES].data());
+		writer.close();
+	}));
+	writers.push_back(benchmarkWriter("RowArena", [&]()
+	{
+		RowArena arena(12);
+		for (int i = 0; i < WRITTEN_ROWS; i++)
+			arena.write(rowCandidates[i % CANDIDATES].data());
+	}));
+	std::remove(jsonPath.c_str());
+	std::remove(binaryPath.c_str());
+
+	peakKilobytes = std::max(peakKilobytes, peakMemoryKilobytes());
+	writeResults(resultsFile, peakKilobytes, generators, engines, predicates, steps, writers);
+	std::cout << "Wrote the results to " << resultsFile << ".\n";
+	return passed ? 0 : 1;
+}
+
+/// <summary>
+/// Makes a fixed set of random permutations. The generator and the shuffle are written
+/// out here, so every build and every standard library gets the same candidates.
+/// </summary>
+/// <param name="length">The number of digits in each permutation</param>
+/// <param name="first">The smallest digit</param>
+/// <param name="fixFirst">True to keep the first digit in place, as a row beginning with 0</param>
+/// <param name="count">The number of permutations</param>
+/// <returns>The permutations</returns>
+static std::vector<std::vector<int>> makeCandidates(int length, int first, bool fixFirst, int count)
+{
+	std::mt19937 random(20220729);
+	std::vector<std::vector<int>> candidates(count, std::vector<int>(length));
+	for (int i = 0; i < count; i++)
+	{
+		for (int j = 0; j < length; j++)
+			candidates[i][j] = first + j;
+		for (int j = length - 1; j > (fixFirst ? 1 : 0); j--)
+		{
+			int k = (fixFirst ? 1 : 0) + (int)(random() % (uint32_t)(j + (fixFirst ? 0 : 1)));
+			std::swap(candidates[i][j], candidates[i][k]);
+		}
+	}
+	return candidates;
+}
+
+/// <summary>
+/// Runs a measurement several times
+/// </summary>
+/// <param name="run">The measurement</param>
+/// <returns>The fastest time in milliseconds</returns>
+static double timeBest(const std::function<void()>& run)
+{
+	double best = 0;
+	for (int i = 0; i < REPEATS; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		run();
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (i == 0 || ms < best)
+			best = ms;
+	}
+	return best;
+}
+
+/// <summary>
+/// Gets the most memory the process has held at once, since the last reset on Linux
+/// </summary>
+/// <returns>The peak resident set size in kilobytes</returns>
+static uint64_t peakMemoryKilobytes()
+{
+#ifdef __linux__
+	// ru_maxrss also keeps the peak of threads that have exited, so it is not reset
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line))
+	{
+		if (line.compare(0, 6, "VmHWM:") == 0)
+			return std::stoull(line.substr(6));
+	}
+#endif
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.PeakWorkingSetSize / 1024;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+#endif
+}
+
+/// <summary>
+/// Sets the peak memory of the process back to the memory it holds now
+/// </summary>
+/// <returns>True if the peak was reset, which is only possible on Linux</returns>
+static bool resetPeakMemory()
+{
+#ifdef __linux__
+	std::ofstream clear("/proc/self/clear_refs");
+	clear << "5";
+	clear.close();
+	return !clear.fail();
+#else
+	return false;
+#endif
+}
+
+/// <summary>
+/// Writes one group of results as a JSON array
+/// </summary>
+/// <param name="out">The stream to write to</param>
+/// <param name="name">The name of the group</param>
+/// <param name="results">The results</param>
+/// <param name="rowsName">The name of the rows field, or empty to leave it out</param>
+/// <param name="nodesName">The name of the nodes field, or empty to leave it out</param>
+/// <param name="perNodeName">The name of the field for the time per node</param>
+static void writeResultGroup(std::ostream& out, const char* name, const std::vector<BenchmarkResult>& results, const char* rowsName, const char* nodesName, const char* perNodeName)
+{
+	out << "    \"" << name << "\": [\n";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult& result = results[i];
+		out << "        { \"name\": \"" << result.name << "\", \"ms\": " << result.ms;
+		if (*rowsName)
+		{
+			out << ", \"" << rowsName << "\": " << result.rows;
+			if (result.ms > 0)
+				out << ", \"rowsPerSecond\": " << (uint64_t)(result.rows * 1000.0 / result.ms);
+		}
+		if (*nodesName)
+		{
+			out << ", \"" << nodesName << "\": " << result.nodes;
+			if (result.nodes > 0)
+				out << ", \"" << perNodeName << "\": " << result.ms * 1e6 / result.nodes;
+		}
+		if (result.peakKilobytes > 0)
+			out << ", \"peakKilobytes\": " << result.peakKilobytes;
+		out << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "    ]";
+}
+
+/// <summary>
+/// Writes every result to a JSON file and to the console
+/// </summary>
+/// <param name="path">The file to write to</param>
+/// <param name="peakKilobytes">The most memory the process held at once</param>
+/// <param name="generators">The end-to-end times of the generators</param>
+/// <param name="engines">The serial searches with a counting predicate</param>
+/// <param name="predicates">The predicates on the candidate rows</param>
+/// <param name="steps">The step functions</param>
+/// <param name="writers">The writers</param>
+static void writeResults(std::string path, uint64_t peakKilobytes, const std::vector<BenchmarkResult>& generators, const std::vector<BenchmarkResult>& engines,
+	const std::vector<BenchmarkResult>& predicates, const std::vector<BenchmarkResult>& steps, const std::vector<BenchmarkResult>& writers)
+{
+	std::ostringstream out;
+	out << "{\n";
+	out << "    \"simd\": \"" << (hasVectorTrichordKernel() ? "avx2" : "none") << "\",\n";
+#ifdef BAUER_INSTRUMENT
+	out << "    \"instrumented\": true,\n";
+#else
+	out << "    \"instrumented\": false,\n";
+#endif
+	out << "    \"repeats\": " << REPEATS << ",\n";
+	out << "    \"peakMemoryKilobytes\": " << peakKilobytes << ",\n";
+	writeResultGroup(out, "generators", generators, "", "", "");
+	out << ",\n";
+	writeResultGroup(out, "engines", engines, "rows", "nodes", "nsPerNode");
+	out << ",\n";
+	writeResultGroup(out, "predicates", predicates, "", "calls", "nsPerCall");
+	out << ",\n";
+	writeResultGroup(out, "steps", steps, "rows", "steps", "nsPerStep");
+	out << ",\n";
+	writeResultGroup(out, "writers", writers, "rows", "written", "nsPerRow");
+	out << "\n}\n";
+
+	std::ofstream file(path);
+	file << out.str();
+	file.close();
+	std::cout << out.str();
+}
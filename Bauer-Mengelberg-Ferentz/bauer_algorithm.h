@@ -29,45 +29,148 @@
 #include <iostream>
 #include <string>
 #include <vector>
-
-void generateAllIntervalRowGenerators(std::string destinationFile);
+#include "bauer_arena.h"
+#include "bauer_binary.h"
+#include "bauer_engine.h"
+#include "bauer_parallel.h"
+#include "bauer_shard.h"
+#include "bauer_symmetry.h"
+
+void generateAllIntervalRowGenerators(std::string destinationFile, unsigned int threads = 1, bool resume = false, SearchShard shard = WHOLE_SEARCH);
+void generateCanonicalAllIntervalRowGenerators(std::string destinationFile, int symmetries, bool expandOrbits, unsigned int threads = 1);
 int isValidPermutation(int* permutation);
 void nextPermutation(int* permutation);
-void writeToFile(std::string path, std::vector<int*> found);
+void writeToFile(std::string path, const RowArena& found);
+
+/// <summary>
+/// An incremental version of isValidPermutation. It remembers the partial sums of the
+/// last permutation it checked, so only the sums from the first changed interval onward
+/// are recomputed.
+/// </summary>
+struct AllIntervalPredicate
+{
+	// the partial sum, the bitmask of partial sums reached, and whether a partial sum
+	// has repeated, before each interval
+	int sums[12];
+	int reached[12];
+	bool repeated[12];
+
+	// the number of intervals whose state above is current
+	int checked;
+
+	AllIntervalPredicate() : checked(0)
+	{
+		sums[0] = 0;
+		reached[0] = 0;
+		repeated[0] = false;
+	}
+
+	/// <summary>
+	/// Determines if an eleven-interval permutation is a row generator
+	/// </summary>
+	/// <param name="permutation">An eleven-interval permutation</param>
+	/// <param name="from">The index of the first interval that changed since the last call</param>
+	/// <returns>The index of the partial sum that failed, or -1 if the permutation is a row generator</returns>
+	int operator()(int* permutation, int from)
+	{
+		if (from < checked)
+			checked = from;
+		for (int i = checked; i < 11; i++)
+		{
+			int sum = sums[i] + permutation[i];
+			if (sum >= 12)
+				sum -= 12;
+			if (sum == 0 || (i < 10 && sum == 6))
+			{
+				checked = i;
+				return i;
+			}
+			sums[i + 1] = sum;
+			repeated[i + 1] = repeated[i] || (reached[i] & (1 << sum)) != 0;
+			reached[i + 1] = reached[i] | (1 << sum);
+		}
+		checked = 11;
+		return repeated[11] ? 11 : -1;
+	}
+};
 
 /// <summary>
 /// Generates the all-interval rows
 /// </summary>
-/// <param name="destinationFile">The destination file</param>
-void generateAllIntervalRowGenerators(std::string destinationFile)
+/// <param name="destinationFile">The destination file, in binary if it ends in .bin and in JSON otherwise</param>
+/// <param name="threads">The number of threads to search with, or 0 to use every hardware thread</param>
+/// <param name="resume">True to carry on from the last checkpoint of an unfinished search, if there is one</param>
+/// <param name="shard">The shard of the search to run</param>
+void generateAllIntervalRowGenerators(std::string destinationFile, unsigned int threads, bool resume, SearchShard shard)
 {
-	int permutation[11] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
-	std::vector<int*> found;
+	int permutation[11];
 
-	std::cout << "Starting...\n";
-	nextPermutation(permutation);
+	BAUER_COUNT(resetSearchStats());
+
+	// the part of the search this shard covers. The whole search stops at the first
+	// generator that begins with 6.
+	const int endPrefix[1] = { 6 };
+	int shardEnd[11];
+	int shardEndLength = findShardRange<11, 1>(shard, endPrefix, 1, permutation, shardEnd);
 
-	// consider each possible permutation
-	while (permutation[0] < 6)
+	// carry on from the last checkpoint if asked to
+	SearchCheckpoint checkpoint(destinationFile + ".checkpoint", shardSearchName("elevenIntervalRowGenerators", shard), 11);
+	bool resumed = resume && checkpoint.load(permutation);
+	RowFileWriter writer(destinationFile, "elevenIntervalRowGenerators", 12, 11, checkpoint.output());
+	checkpoint.attach(writer);
+
+	std::cout << (resumed ? "Resuming...\n" : "Starting...\n");
+	if (threads != 1)
+	{
+		searchParallel<11, 1>(AllIntervalPredicate(), shardEnd, shardEndLength, threads, writer, permutation, &checkpoint);
+	}
+	else
 	{
-		// add the new generator to the array
-		int *newFound = new int[11];
-		for (int i = 0; i < 11; i++)
-			newFound[i] = permutation[i];
-		found.push_back(newFound);
-
-		// move to the next permutation
-		nextPermutation(permutation);
+		// look at the starting permutation too, since it may be a checkpoint
+		CheckpointPredicate<AllIntervalPredicate> isValid(AllIntervalPredicate(), checkpoint);
+		seekRow<11, 1>(permutation, isValid);
+
+		// consider each possible permutation up to the end of the shard
+		while (isBeforePrefix(permutation, shardEnd, shardEndLength))
+		{
+			// write the new generator to the file
+			writer.write(permutation);
+
+			// move to the next permutation
+			nextRow<11, 1>(permutation, isValid);
+		}
 	}
 
-	// export the row generators
-	writeToFile(destinationFile, found);
+	// finish the file
+	writer.close();
+	checkpoint.finish();
+	BAUER_COUNT(finishSearchStats(destinationFile + ".stats.json"));
+
+	std::cout << "Done. Found " << writer.count() << " row generators.\n";
+}
+
+/// <summary>
+/// Generates one all-interval row from each orbit under a symmetry group. Rotation
+/// does not apply, since the generators are rows of intervals.
+/// </summary>
+/// <param name="destinationFile">The destination file, in binary if it ends in .bin and in JSON otherwise</param>
+/// <param name="symmetries">The SYMMETRY_* operations that generate the group</param>
+/// <param name="expandOrbits">True to write every generator of each orbit instead of one</param>
+/// <param name="threads">The number of threads to search with, or 0 to use every hardware thread</param>
+void generateCanonicalAllIntervalRowGenerators(std::string destinationFile, int symmetries, bool expandOrbits, unsigned int threads)
+{
+	RowFileWriter writer(destinationFile, "elevenIntervalRowGenerators", 12, 11);
+	RowSymmetryGroup group(symmetries, 11, true);
 
-	// cleanup
-	for (int i = 0; i < found.size(); i++)
-		delete[] found[i];
+	std::cout << "Starting...\n";
+	BAUER_COUNT(resetSearchStats());
+	searchOrbits<11, 1>(AllIntervalPredicate(), group, expandOrbits, threads, writer);
 
-	std::cout << "Done. Found " << found.size()  << " row generators.\n";
+	// finish the file
+	writer.close();
+	BAUER_COUNT(finishSearchStats(destinationFile + ".stats.json"));
+
+	std::cout << "Done. Found " << writer.count() << " row generators.\n";
 }
 
 /// <summary>
@@ -75,7 +178,7 @@ void generateAllIntervalRowGenerators(std::string destinationFile)
 /// </summary>
 /// <param name="permutation">An eleven-interval permutation</param>
 /// <returns>The index of the partial sum that failed, or -1 if the permutation is a row generator</returns>
-static int isValidPermutation(int* permutation)
+int isValidPermutation(int* permutation)
 {
 	int sums[12] = { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
 	int returnVal = -1;
@@ -100,127 +203,23 @@ static int isValidPermutation(int* permutation)
 /// Updates the eleven-interval permutation to the next valid row generator
 /// </summary>
 /// <param name="permutation">The permutation</param>
-static void nextPermutation(int* permutation)
+void nextPermutation(int* permutation)
 {
-	// assume that the permutation is valid
-	int validPermutation = -1;
-
-	do
-	{
-		int criticalIndex = validPermutation;
-		int smallestRight = 0;
-		int buffer[12] = { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
-		buffer[permutation[10]] = permutation[10];
-
-		// if we don't have a critical index already, we need to find it
-		if (criticalIndex == -1 || criticalIndex > 10)
-		{
-			// Identify the index of the critical digit, as well as the smallest number
-			// Critical digit cannot be the last digit; must be index 9 or lower
-			for (int i = 9; i >= 0; i--)
-			{
-				buffer[permutation[i]] = permutation[i];
-
-				// if we have identified the critical digit
-				if (permutation[i] < permutation[i + 1])
-				{
-					smallestRight = permutation[i] + 1;
-					criticalIndex = i;
-					while (buffer[smallestRight] == -1)
-						smallestRight++;
-					permutation[i] = smallestRight;
-					buffer[smallestRight] = -1;
-					break;
-				}
-			}
-		}
-
-		// If the critical index was provided
-		else
-		{
-			for (int i = 9; i >= criticalIndex; i--)
-				buffer[permutation[i]] = permutation[i];
-			smallestRight = permutation[criticalIndex] + 1;
-			// If the critical digit is not 11, search for the smallest right
-			// digit that is larger than the critical digit
-			if (smallestRight < 12)
-			{
-				while (buffer[smallestRight] == -1)
-				{
-					smallestRight++;
-					if (smallestRight > 11)
-						break;
-				}
-			}
-			// If we were unable to find an acceptable smallest right digit,
-			// we need to find a new critical digit.
-			if (smallestRight > 11)
-			{
-				// Identify the index of the critical digit, as well as the smallest number
-				// Critical digit cannot be the last digit; must be index 9 or lower
-				for (int i = criticalIndex - 1; i >= 0; i--)
-				{
-					buffer[permutation[i]] = permutation[i];
-
-					// if we have identified the critical digit
-					if (permutation[i] < permutation[i + 1])
-					{
-						smallestRight = permutation[i] + 1;
-						criticalIndex = i;
-						while (buffer[smallestRight] == -1)
-							smallestRight++;
-						permutation[i] = smallestRight;
-						buffer[smallestRight] = -1;
-						break;
-					}
-				}
-			}
-			else
-			{
-				permutation[criticalIndex] = smallestRight;
-				buffer[smallestRight] = -1;
-			}
-		}
-
-		// Update the permutation and reset the buffer
-		smallestRight = 0;
-		for (int i = criticalIndex + 1; i < 11; i++)
-		{
-			while (buffer[smallestRight] == -1)
-				smallestRight++;
-			permutation[i] = smallestRight;
-			smallestRight++;
-		}
-		validPermutation = isValidPermutation(permutation);
-	} while (validPermutation > -1);
+	AllIntervalPredicate isValid;
+	nextRow<11, 1>(permutation, isValid);
 }
 
 /// <summary>
 /// Writes found eleven-interval row generators to file
 /// </summary>
 /// <param name="path">The file to write to</param>
-/// <param name="found">A vector of found generators</param>
-static void writeToFile(std::string path, std::vector<int*> found)
+/// <param name="found">An arena of found generators</param>
+void writeToFile(std::string path, const RowArena& found)
 {
-	std::ofstream file;
-	file.open(path);
-	file << "{\n    \"elevenIntervalRowGenerators\": [\n";
-	for (int i = 0; i < found.size() - 1; i++)
-	{
-		file << "        [";
-		for (int j = 0; j < 10; j++)
-			file << found[i][j] << ", ";
-		file << found[i][10] << "],\n";
-	}
-	if (found.size() > 0)
-	{
-		file << "        [";
-		for (int j = 0; j < 10; j++)
-			file << found[found.size() - 1][j] << ", ";
-		file << found[found.size() - 1][10] << "]\n";
-	}
-	file << "    ]\n}\n";
-	file.close();
+	JsonRowWriter writer(path, "elevenIntervalRowGenerators", found.length());
+	for (size_t i = 0; i < found.size(); i++)
+		writer.write(found[i]);
+	writer.close();
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,135 @@
+/*
+* File: bauer_arena.h
+* Author: Jeff Martin
+*
+* This file contains a growable arena for keeping found rows in memory. Each
+* row is stored as contiguous bytes, one per pc or interval, in a single
+* buffer, so keeping a row costs no allocation of its own. Rows are read back
+* through non-owning views.
+*
+* Copyright  2022 by Jeffrey Martin. All rights reserved.
+* Email: jmartin@jeffreymartincomposer.com
+* Website: https://jeffreymartincomposer.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BAUERARENA
+#define BAUERARENA
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// A non-owning view of one row in a RowArena
+/// </summary>
+struct RowView
+{
+	const uint8_t* pcs;
+	int length;
+
+	/// <summary>
+	/// Gets one pc or interval of the row
+	/// </summary>
+	/// <param name="i">The index</param>
+	/// <returns>The pc or interval</returns>
+	int operator[](int i) const
+	{
+		return pcs[i];
+	}
+
+	/// <summary>
+	/// Gets the number of pcs or intervals in the row
+	/// </summary>
+	/// <returns>The length of the row</returns>
+	int size() const
+	{
+		return length;
+	}
+};
+
+/// <summary>
+/// Keeps rows in memory, one byte per pc or interval, in a single growable buffer
+/// </summary>
+class RowArena
+{
+public:
+	/// <summary>
+	/// Creates an empty arena
+	/// </summary>
+	/// <param name="length">The number of pcs or intervals in each row</param>
+	RowArena(int length) : width(length) {}
+
+	/// <summary>
+	/// Copies a row into the arena
+	/// </summary>
+	/// <param name="row">The row</param>
+	void write(const int* row)
+	{
+		for (int i = 0; i < width; i++)
+			pcs.push_back((uint8_t)row[i]);
+	}
+
+	/// <summary>
+	/// Gets a view of one row
+	/// </summary>
+	/// <param name="i">The index of the row</param>
+	/// <returns>The row</returns>
+	RowView operator[](size_t i) const
+	{
+		RowView row = { pcs.data() + i * width, width };
+		return row;
+	}
+
+	/// <summary>
+	/// Gets the number of rows in the arena
+	/// </summary>
+	/// <returns>The number of rows</returns>
+	size_t size() const
+	{
+		return pcs.size() / width;
+	}
+
+	/// <summary>
+	/// Gets the number of pcs or intervals in each row
+	/// </summary>
+	/// <returns>The length of each row</returns>
+	int length() const
+	{
+		return width;
+	}
+
+	/// <summary>
+	/// Gets the stored rows, one after another
+	/// </summary>
+	/// <returns>The bytes of the rows</returns>
+	const uint8_t* data() const
+	{
+		return pcs.data();
+	}
+
+	/// <summary>
+	/// Removes every row and releases the memory
+	/// </summary>
+	void clear()
+	{
+		std::vector<uint8_t>().swap(pcs);
+	}
+
+private:
+	std::vector<uint8_t> pcs;
+	int width;
+};
+
+#endif
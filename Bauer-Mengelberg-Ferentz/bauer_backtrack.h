@@ -0,0 +1,197 @@
+/*
+* File: bauer_backtrack.h
+* Author: Jeff Martin
+*
+* This file contains a depth-first backtracking search for all-interval row
+* generators in any even equal temperament of up to 64 notes. The generator is
+* built one interval at a time, keeping a running sum and bitmasks of the
+* pitch classes already reached and the intervals still unused, so a branch
+* is abandoned at the first repeated pc and no invalid generator is ever
+* completed. In 12-TET the generators are found in the same order as the
+* skip-ahead enumerator in bauer_algorithm.h.
+*
+* Copyright  2022 by Jeffrey Martin. All rights reserved.
+* Email: jmartin@jeffreymartincomposer.com
+* Website: https://jeffreymartincomposer.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BAUERBACKTRACK
+#define BAUERBACKTRACK
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "bauer_algorithm.h"
+
+void compareAllIntervalEngines();
+template <typename Sink>
+static void extendIntervalRowGenerator(int modulus, int* permutation, int depth, int sum, uint64_t reached, uint64_t unused, Sink& sink);
+template <typename Sink>
+void findAllIntervalRowGeneratorsBacktracking(Sink& sink);
+template <typename Sink>
+void findIntervalRowGenerators(int modulus, Sink& sink);
+void generateAllIntervalRowGeneratorsBacktracking(std::string destinationFile);
+void generateIntervalRowGenerators(std::string destinationFile, int modulus);
+
+/// <summary>
+/// Generates the all-interval rows with the backtracking search
+/// </summary>
+/// <param name="destinationFile">The destination file, in binary if it ends in .bin and in JSON otherwise</param>
+void generateAllIntervalRowGeneratorsBacktracking(std::string destinationFile)
+{
+	generateIntervalRowGenerators(destinationFile, 12);
+}
+
+/// <summary>
+/// Generates the all-interval rows of an even equal temperament with the backtracking search
+/// </summary>
+/// <param name="destinationFile">The destination file, in binary if it ends in .bin and in JSON otherwise</param>
+/// <param name="modulus">The number of notes in the octave, an even number from 4 to 64</param>
+void generateIntervalRowGenerators(std::string destinationFile, int modulus)
+{
+	RowFileWriter writer(destinationFile, modulus == 12 ? "elevenIntervalRowGenerators" : "intervalRowGenerators", modulus, modulus - 1);
+	BAUER_COUNT(resetSearchStats());
+
+	std::cout << "Starting...\n";
+	findIntervalRowGenerators(modulus, writer);
+
+	// finish the file
+	writer.close();
+	BAUER_COUNT(finishSearchStats(destinationFile + ".stats.json"));
+
+	std::cout << "Done. Found " << writer.count() << " row generators.\n";
+}
+
+/// <summary>
+/// Finds the eleven-interval row generators that begin with an interval smaller than 6
+/// </summary>
+/// <param name="sink">The sink to write the generators to</param>
+template <typename Sink>
+void findAllIntervalRowGeneratorsBacktracking(Sink& sink)
+{
+	findIntervalRowGenerators(12, sink);
+}
+
+/// <summary>
+/// Finds the all-interval row generators of an even equal temperament that begin with
+/// an interval smaller than half the octave
+/// </summary>
+/// <param name="modulus">The number of notes in the octave, an even number from 4 to 64</param>
+/// <param name="sink">The sink to write the generators to</param>
+template <typename Sink>
+void findIntervalRowGenerators(int modulus, Sink& sink)
+{
+	// the intervals of an odd modulus sum to 0, so the last pc would repeat the first
+	if (modulus < 4 || modulus > 64 || modulus % 2 != 0)
+		throw std::invalid_argument("The modulus must be an even number from 4 to 64");
+
+	int permutation[63];
+	uint64_t unused = 0;
+	for (int interval = 1; interval < modulus; interval++)
+		unused |= (uint64_t)1 << interval;
+
+	// pc 0 is reached before the first interval
+	extendIntervalRowGenerator(modulus, permutation, 0, 0, 1, unused, sink);
+}
+
+/// <summary>
+/// Tries every unused interval at one position of a partial row generator
+/// </summary>
+/// <param name="modulus">The number of notes in the octave</param>
+/// <param name="permutation">The partial row generator</param>
+/// <param name="depth">The position to fill</param>
+/// <param name="sum">The pc reached by the intervals before the position</param>
+/// <param name="reached">A bitmask of the pcs reached so far</param>
+/// <param name="unused">A bitmask of the intervals not used yet</param>
+/// <param name="sink">The sink to write the generators to</param>
+template <typename Sink>
+static void extendIntervalRowGenerator(int modulus, int* permutation, int depth, int sum, uint64_t reached, uint64_t unused, Sink& sink)
+{
+	if (depth == modulus - 1)
+	{
+		BAUER_COUNT(countLeaf(true));
+		sink.write(permutation);
+		return;
+	}
+
+	// the intervals sum to half the octave, so the tritone can only be the last pc reached
+	int tritone = modulus / 2;
+	bool last = depth == modulus - 2;
+
+	// generators beginning with a tritone or more are inversions of ones we have already found
+	uint64_t candidates = depth == 0 ? unused & (((uint64_t)1 << tritone) - 1) : unused;
+	while (candidates)
+	{
+		int interval = lowestDigitWide(candidates);
+		candidates &= candidates - 1;
+		int pc = sum + interval;
+		if (pc >= modulus)
+			pc -= modulus;
+		BAUER_COUNT(countNode(depth));
+		if (((reached >> pc) & 1) || ((pc == tritone) != last))
+		{
+			BAUER_COUNT(countPrune(depth));
+			continue;
+		}
+		permutation[depth] = interval;
+		extendIntervalRowGenerator(modulus, permutation, depth + 1, pc, reached | ((uint64_t)1 << pc), unused & ~((uint64_t)1 << interval), sink);
+	}
+}
+
+/// <summary>
+/// Runs the skip-ahead enumerator and the backtracking search, checks that they find
+/// the same generators, and reports how long each one took
+/// </summary>
+void compareAllIntervalEngines()
+{
+	RowArena enumerated(11);
+	RowArena backtracked(11);
+
+	auto start = std::chrono::steady_clock::now();
+	int permutation[11] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+	AllIntervalPredicate isValid;
+	nextRow<11, 1>(permutation, isValid);
+	while (permutation[0] < 6)
+	{
+		enumerated.write(permutation);
+		nextRow<11, 1>(permutation, isValid);
+	}
+	auto middle = std::chrono::steady_clock::now();
+	findAllIntervalRowGeneratorsBacktracking(backtracked);
+	auto end = std::chrono::steady_clock::now();
+
+	bool same = enumerated.size() == backtracked.size();
+	for (size_t i = 0; same && i < enumerated.size(); i++)
+	{
+		for (int j = 0; j < 11; j++)
+		{
+			if (enumerated[i][j] != backtracked[i][j])
+				same = false;
+		}
+	}
+
+	double enumeratorTime = std::chrono::duration<double, std::milli>(middle - start).count();
+	double backtrackingTime = std::chrono::duration<double, std::milli>(end - middle).count();
+	std::cout << "Skip-ahead enumerator: " << enumerated.size() << " row generators in " << enumeratorTime << " ms\n";
+	std::cout << "Backtracking search: " << backtracked.size() << " row generators in " << backtrackingTime << " ms\n";
+	if (backtrackingTime > 0)
+		std::cout << "Speedup: " << enumeratorTime / backtrackingTime << "x\n";
+	std::cout << (same ? "The results match.\n" : "The results do not match!\n");
+}
+
+#endif
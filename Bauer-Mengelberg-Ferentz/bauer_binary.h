@@ -0,0 +1,588 @@
+/*
+* File: bauer_binary.h
+* Author: Jeff Martin
+*
+* This file contains a compact binary format for found rows, a sink that
+* writes it, a memory-mapped reader for it, and conversions to and from the
+* JSON files the generators write.
+*
+* A binary row file starts with a 64-byte header:
+*     0   magic "BMFR"
+*     4   format version (16-bit little-endian), currently 1
+*     6   modulus
+*     7   number of pcs or intervals in each row
+*     8   bits per pc or interval (4, or 8 for moduli above 16)
+*     9   reserved (7 bytes of zero)
+*     16  number of rows (64-bit little-endian)
+*     24  name of the generator, as in the JSON files (40 bytes, zero padded)
+* followed by the rows at a fixed width. With 4 bits per value, value i of a row
+* is in the low nibble of byte i / 2 when i is even and in the high nibble when
+* i is odd, so a twelve-tone row takes 6 bytes.
+*
+* Copyright  2022 by Jeffrey Martin. All rights reserved.
+* Email: jmartin@jeffreymartincomposer.com
+* Website: https://jeffreymartincomposer.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BAUERBINARY
+#define BAUERBINARY
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "bauer_output.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const int BINARY_ROW_HEADER_SIZE = 64;
+const int BINARY_ROW_NAME_SIZE = 40;
+const int BINARY_ROW_VERSION = 1;
+
+void convertBinaryToJson(std::string binaryPath, std::string jsonPath);
+void convertJsonToBinary(std::string jsonPath, std::string binaryPath, int emptyModulus = 0, int emptyLength = 0);
+inline int jsonRowModulus(int length, bool hasZero, int largest);
+
+/// <summary>
+/// Writes rows to a binary row file as they are found
+/// </summary>
+class BinaryRowWriter
+{
+public:
+	/// <summary>
+	/// Opens the file and writes a header with a row count of zero
+	/// </summary>
+	/// <param name="path">The file to write to</param>
+	/// <param name="name">The name of the generator</param>
+	/// <param name="modulus">The modulus of the pcs or intervals</param>
+	/// <param name="length">The number of pcs or intervals in each row</param>
+	/// <param name="resumeAt">Where to carry on an unfinished file, or zero to start a new one</param>
+	BinaryRowWriter(std::string path, std::string name, int modulus, int length, RowFilePosition resumeAt = RowFilePosition())
+		: name(name), modulus(modulus), length(length), bits(modulus > 16 ? 8 : 4), rows(resumeAt.rows)
+	{
+		rowBytes = (length * bits + 7) / 8;
+		if (resumeAt.bytes > 0)
+		{
+			// drop anything written after that point. The row count is filled in on close.
+			truncateFile(path, resumeAt.bytes);
+			file.open(path, std::ios::binary | std::ios::in | std::ios::out);
+			file.seekp(0, std::ios::end);
+			return;
+		}
+		file.open(path, std::ios::binary);
+		writeHeader();
+	}
+
+	~BinaryRowWriter()
+	{
+		close();
+	}
+
+	/// <summary>
+	/// Packs a row and writes it to the file
+	/// </summary>
+	/// <param name="row">The row</param>
+	void write(const int* row)
+	{
+		size_t start = buffer.size();
+		buffer.resize(start + rowBytes, 0);
+		for (int i = 0; i < length; i++)
+		{
+			if (bits == 8)
+				buffer[start + i] = (char)row[i];
+			else
+				buffer[start + i / 2] |= (char)(row[i] << (i % 2 * 4));
+		}
+		rows++;
+		if (buffer.size() >= (1 << 20))
+			flush();
+	}
+
+	/// <summary>
+	/// Writes the remaining rows, fills in the row count and closes the file
+	/// </summary>
+	void close()
+	{
+		if (!file.is_open())
+			return;
+		flush();
+		file.seekp(0);
+		writeHeader();
+		file.close();
+	}
+
+	/// <summary>
+	/// Writes the buffered rows to the file. The header still has the row count it was
+	/// opened with until the file is closed.
+	/// </summary>
+	/// <returns>How much of the file is complete</returns>
+	RowFilePosition sync()
+	{
+		flush();
+		file.flush();
+		RowFilePosition position = { rows, (uint64_t)file.tellp() };
+		return position;
+	}
+
+	/// <summary>
+	/// Gets the number of rows written so far
+	/// </summary>
+	/// <returns>The number of rows</returns>
+	size_t count() const
+	{
+		return rows;
+	}
+
+private:
+	std::ofstream file;
+	std::vector<char> buffer;
+	std::string name;
+	int modulus;
+	int length;
+	int bits;
+	int rowBytes;
+	uint64_t rows;
+
+	void flush()
+	{
+		file.write(buffer.data(), buffer.size());
+		buffer.clear();
+	}
+
+	void writeHeader()
+	{
+		unsigned char header[BINARY_ROW_HEADER_SIZE] = { 'B', 'M', 'F', 'R' };
+		header[4] = BINARY_ROW_VERSION & 0xFF;
+		header[5] = BINARY_ROW_VERSION >> 8;
+		header[6] = (unsigned char)modulus;
+		header[7] = (unsigned char)length;
+		header[8] = (unsigned char)bits;
+		for (int i = 0; i < 8; i++)
+			header[16 + i] = (unsigned char)(rows >> (i * 8));
+		for (int i = 0; i < BINARY_ROW_NAME_SIZE - 1 && i < (int)name.size(); i++)
+			header[24 + i] = (unsigned char)name[i];
+		file.write((const char*)header, BINARY_ROW_HEADER_SIZE);
+	}
+};
+
+/// <summary>
+/// A non-owning view of one packed row in a binary row file
+/// </summary>
+struct PackedRowView
+{
+	const unsigned char* bytes;
+	int length;
+	int bits;
+
+	/// <summary>
+	/// Unpacks one pc or interval of the row
+	/// </summary>
+	/// <param name="i">The index</param>
+	/// <returns>The pc or interval</returns>
+	int operator[](int i) const
+	{
+		if (bits == 8)
+			return bytes[i];
+		return (bytes[i / 2] >> (i % 2 * 4)) & 0xF;
+	}
+
+	/// <summary>
+	/// Gets the number of pcs or intervals in the row
+	/// </summary>
+	/// <returns>The length of the row</returns>
+	int size() const
+	{
+		return length;
+	}
+
+	/// <summary>
+	/// Unpacks the row into an array
+	/// </summary>
+	/// <param name="row">An array with room for the row</param>
+	void copyTo(int* row) const
+	{
+		for (int i = 0; i < length; i++)
+			row[i] = (*this)[i];
+	}
+};
+
+/// <summary>
+/// A read-only, memory-mapped binary row file. The rows are read in place, with
+/// no parsing or copying, and can be visited in any order.
+/// </summary>
+class BinaryRowFile
+{
+public:
+	/// <summary>
+	/// A random-access iterator over the rows of the file
+	/// </summary>
+	class iterator
+	{
+	public:
+		typedef std::random_access_iterator_tag iterator_category;
+		typedef PackedRowView value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const PackedRowView* pointer;
+		typedef PackedRowView reference;
+
+		iterator(const BinaryRowFile* file, size_t index) : file(file), index(index) {}
+		PackedRowView operator*() const { return (*file)[index]; }
+		PackedRowView operator[](difference_type n) const { return (*file)[index + n]; }
+		iterator& operator++() { index++; return *this; }
+		iterator& operator--() { index--; return *this; }
+		iterator operator++(int) { iterator old = *this; index++; return old; }
+		iterator operator--(int) { iterator old = *this; index--; return old; }
+		iterator& operator+=(difference_type n) { index += n; return *this; }
+		iterator& operator-=(difference_type n) { index -= n; return *this; }
+		iterator operator+(difference_type n) const { return iterator(file, index + n); }
+		iterator operator-(difference_type n) const { return iterator(file, index - n); }
+		difference_type operator-(const iterator& other) const { return (difference_type)index - (difference_type)other.index; }
+		bool operator==(const iterator& other) const { return index == other.index; }
+		bool operator!=(const iterator& other) const { return index != other.index; }
+		bool operator<(const iterator& other) const { return index < other.index; }
+		bool operator>(const iterator& other) const { return index > other.index; }
+		bool operator<=(const iterator& other) const { return index <= other.index; }
+		bool operator>=(const iterator& other) const { return index >= other.index; }
+
+	private:
+		const BinaryRowFile* file;
+		size_t index;
+	};
+
+	/// <summary>
+	/// Maps a binary row file into memory and checks its header
+	/// </summary>
+	/// <param name="path">The file to read</param>
+	BinaryRowFile(std::string path) : mapped(nullptr), mappedSize(0)
+	{
+#ifdef _WIN32
+		mappingHandle = NULL;
+		fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (fileHandle == INVALID_HANDLE_VALUE)
+			throw std::runtime_error("Could not open " + path);
+		LARGE_INTEGER size;
+		GetFileSizeEx(fileHandle, &size);
+		mappedSize = (size_t)size.QuadPart;
+		mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mappingHandle != NULL)
+			mapped = (const unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+		descriptor = open(path.c_str(), O_RDONLY);
+		if (descriptor < 0)
+			throw std::runtime_error("Could not open " + path);
+		struct stat status;
+		fstat(descriptor, &status);
+		mappedSize = (size_t)status.st_size;
+		if (mappedSize > 0)
+		{
+			void* address = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, descriptor, 0);
+			if (address != MAP_FAILED)
+				mapped = (const unsigned char*)address;
+		}
+#endif
+		if (mapped == nullptr || mappedSize < BINARY_ROW_HEADER_SIZE || std::memcmp(mapped, "BMFR", 4) != 0)
+		{
+			unmap();
+			throw std::runtime_error(path + " is not a binary row file");
+		}
+		if ((mapped[4] | (mapped[5] << 8)) != BINARY_ROW_VERSION)
+		{
+			unmap();
+			throw std::runtime_error(path + " has an unsupported version");
+		}
+		rowCount = 0;
+		for (int i = 0; i < 8; i++)
+			rowCount |= (uint64_t)mapped[16 + i] << (i * 8);
+		rowBytes = (mapped[7] * mapped[8] + 7) / 8;
+		if (mappedSize < BINARY_ROW_HEADER_SIZE + rowCount * rowBytes)
+		{
+			unmap();
+			throw std::runtime_error(path + " is truncated");
+		}
+	}
+
+	~BinaryRowFile()
+	{
+		unmap();
+	}
+
+	BinaryRowFile(const BinaryRowFile&) = delete;
+	BinaryRowFile& operator=(const BinaryRowFile&) = delete;
+
+	/// <summary>
+	/// Gets a view of one row
+	/// </summary>
+	/// <param name="i">The index of the row</param>
+	/// <returns>The row</returns>
+	PackedRowView operator[](size_t i) const
+	{
+		PackedRowView row = { mapped + BINARY_ROW_HEADER_SIZE + i * rowBytes, mapped[7], mapped[8] };
+		return row;
+	}
+
+	iterator begin() const { return iterator(this, 0); }
+	iterator end() const { return iterator(this, (size_t)rowCount); }
+
+	/// <summary>
+	/// Gets the number of rows in the file
+	/// </summary>
+	/// <returns>The number of rows</returns>
+	size_t size() const
+	{
+		return (size_t)rowCount;
+	}
+
+	/// <summary>
+	/// Gets the name of the generator that wrote the file
+	/// </summary>
+	/// <returns>The name of the generator</returns>
+	std::string name() const
+	{
+		const char* start = (const char*)mapped + 24;
+		return std::string(start, strnlen(start, BINARY_ROW_NAME_SIZE));
+	}
+
+	/// <summary>
+	/// Gets the modulus of the pcs or intervals
+	/// </summary>
+	/// <returns>The modulus</returns>
+	int modulus() const
+	{
+		return mapped[6];
+	}
+
+	/// <summary>
+	/// Gets the number of pcs or intervals in each row
+	/// </summary>
+	/// <returns>The length of each row</returns>
+	int length() const
+	{
+		return mapped[7];
+	}
+
+private:
+	const unsigned char* mapped;
+	size_t mappedSize;
+	uint64_t rowCount;
+	int rowBytes;
+#ifdef _WIN32
+	HANDLE fileHandle;
+	HANDLE mappingHandle;
+#else
+	int descriptor;
+#endif
+
+	void unmap()
+	{
+#ifdef _WIN32
+		if (mapped != nullptr)
+			UnmapViewOfFile(mapped);
+		if (mappingHandle != NULL)
+			CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+#else
+		if (mapped != nullptr)
+			munmap((void*)mapped, mappedSize);
+		close(descriptor);
+#endif
+		mapped = nullptr;
+	}
+};
+
+/// <summary>
+/// Writes rows to a JSON or binary row file, depending on whether the path ends in .bin
+/// </summary>
+class RowFileWriter
+{
+public:
+	/// <summary>
+	/// Opens the file
+	/// </summary>
+	/// <param name="path">The file to write to</param>
+	/// <param name="name">The name of the generator</param>
+	/// <param name="modulus">The modulus of the pcs or intervals</param>
+	/// <param name="length">The number of pcs or intervals in each row</param>
+	/// <param name="resumeAt">Where to carry on an unfinished file, or zero to start a new one</param>
+	RowFileWriter(std::string path, std::string name, int modulus, int length, RowFilePosition resumeAt = RowFilePosition())
+	{
+		if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".bin") == 0)
+			binary.reset(new BinaryRowWriter(path, name, modulus, length, resumeAt));
+		else
+			json.reset(new JsonRowWriter(path, name, length, resumeAt));
+	}
+
+	/// <summary>
+	/// Writes a row to the file
+	/// </summary>
+	/// <param name="row">The row</param>
+	void write(const int* row)
+	{
+		if (binary)
+			binary->write(row);
+		else
+			json->write(row);
+	}
+
+	/// <summary>
+	/// Finishes and closes the file
+	/// </summary>
+	void close()
+	{
+		if (binary)
+			binary->close();
+		else
+			json->close();
+	}
+
+	/// <summary>
+	/// Writes the buffered rows to the file
+	/// </summary>
+	/// <returns>How much of the file is complete</returns>
+	RowFilePosition sync()
+	{
+		return binary ? binary->sync() : json->sync();
+	}
+
+	/// <summary>
+	/// Gets the number of rows written so far
+	/// </summary>
+	/// <returns>The number of rows</returns>
+	size_t count() const
+	{
+		return binary ? binary->count() : json->count();
+	}
+
+private:
+	std::unique_ptr<BinaryRowWriter> binary;
+	std::unique_ptr<JsonRowWriter> json;
+};
+
+/// <summary>
+/// Converts a binary row file to the JSON layout the generators write
+/// </summary>
+/// <param name="binaryPath">The binary row file</param>
+/// <param name="jsonPath">The JSON file to write</param>
+void convertBinaryToJson(std::string binaryPath, std::string jsonPath)
+{
+	BinaryRowFile rows(binaryPath);
+	JsonRowWriter writer(jsonPath, rows.name(), rows.length());
+	std::vector<int> row(rows.length());
+	for (size_t i = 0; i < rows.size(); i++)
+	{
+		rows[i].copyTo(row.data());
+		writer.write(row.data());
+	}
+	writer.close();
+}
+
+/// <summary>
+/// Works out the modulus of the rows of a JSON file, which does not record it. Rows of
+/// pcs contain 0 and rows of intervals do not, and no value can reach the modulus.
+/// </summary>
+/// <param name="length">The number of pcs or intervals in each row</param>
+/// <param name="hasZero">True if any row contains 0</param>
+/// <param name="largest">The largest value in any row</param>
+/// <returns>The modulus</returns>
+inline int jsonRowModulus(int length, bool hasZero, int largest)
+{
+	int modulus = hasZero ? length : length + 1;
+	if (largest >= modulus)
+		modulus = largest + 1;
+	return modulus;
+}
+
+/// <summary>
+/// Converts a JSON file written by a generator to a binary row file. The modulus comes
+/// from jsonRowModulus. A file with no rows shows neither its modulus nor its length, so
+/// they must be given for it.
+/// </summary>
+/// <param name="jsonPath">The JSON file</param>
+/// <param name="binaryPath">The binary row file to write</param>
+/// <param name="emptyModulus">The modulus to use if the file has no rows</param>
+/// <param name="emptyLength">The number of pcs or intervals in each row if the file has no rows</param>
+void convertJsonToBinary(std::string jsonPath, std::string binaryPath, int emptyModulus, int emptyLength)
+{
+	std::ifstream file(jsonPath);
+	std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	// the name of the generator is the only key in the file
+	size_t nameStart = text.find('"');
+	size_t nameEnd = text.find('"', nameStart + 1);
+	if (nameStart == std::string::npos || nameEnd == std::string::npos)
+		throw std::runtime_error(jsonPath + " is not a row file");
+	std::string name = text.substr(nameStart + 1, nameEnd - nameStart - 1);
+
+	// read the rows
+	std::vector<int> values;
+	int length = 0;
+	int largest = 0;
+	bool hasZero = false;
+	size_t position = text.find('[', nameEnd);
+	while ((position = text.find('[', position + 1)) != std::string::npos)
+	{
+		size_t rowEnd = text.find(']', position);
+		int rowLength = 0;
+		const char* cursor = text.c_str() + position + 1;
+		const char* stop = text.c_str() + rowEnd;
+		while (cursor < stop)
+		{
+			char* next;
+			long value = std::strtol(cursor, &next, 10);
+			if (next == cursor)
+				break;
+			values.push_back((int)value);
+			largest = value > largest ? (int)value : largest;
+			hasZero = hasZero || value == 0;
+			rowLength++;
+			cursor = next;
+			while (cursor < stop && (*cursor == ',' || *cursor == ' '))
+				cursor++;
+		}
+		if (length == 0)
+			length = rowLength;
+		else if (rowLength != length)
+			throw std::runtime_error(jsonPath + " has rows of different lengths");
+		position = rowEnd;
+	}
+
+	int modulus = jsonRowModulus(length, hasZero, largest);
+	if (values.empty())
+	{
+		if (emptyModulus <= 0 || emptyLength <= 0)
+			throw std::invalid_argument(jsonPath + " has no rows, so its modulus and length must be given");
+		modulus = emptyModulus;
+		length = emptyLength;
+	}
+
+	BinaryRowWriter writer(binaryPath, name, modulus, length);
+	for (size_t i = 0; i < values.size(); i += length)
+		writer.write(&values[i]);
+	writer.close();
+}
+
+#endif
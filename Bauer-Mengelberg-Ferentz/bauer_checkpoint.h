@@ -0,0 +1,319 @@
+/*
+* File: bauer_checkpoint.h
+* Author: Jeff Martin
+*
+* This file contains checkpoints for long searches. Every so often a search
+* saves the permutation it has reached, which is a point where every valid
+* row before it has been written and none after it, along with how much of
+* the output file is complete. If the program is stopped, the search can be
+* resumed from the last checkpoint: the output file is cut back to where the
+* checkpoint left it and the search seeks to the saved permutation. Each
+* checkpoint is written to a temporary file that then replaces the old one,
+* so a checkpoint on disk is always complete, even if the program is stopped
+* while it is being written. When a search finishes, its checkpoint is
+* deleted, so nothing is left next to the output, and resuming it again starts
+* it over.
+*
+* Copyright  2022 by Jeffrey Martin. All rights reserved.
+* Email: jmartin@jeffreymartincomposer.com
+* Website: https://jeffreymartincomposer.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BAUERCHECKPOINT
+#define BAUERCHECKPOINT
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "bauer_binary.h"
+#include "bauer_stats.h"
+
+const int CHECKPOINT_VERSION = 1;
+
+// how often a search saves a checkpoint
+const int CHECKPOINT_INTERVAL_SECONDS = 60;
+
+// the number of predicate calls between looks at the clock
+const int CHECKPOINT_CLOCK_CALLS = 1 << 16;
+
+/// <summary>
+/// The checkpoints of one search, kept in a file next to the output file
+/// </summary>
+class SearchCheckpoint
+{
+public:
+	/// <summary>
+	/// Sets up the checkpoints of a search, without reading or writing anything
+	/// </summary>
+	/// <param name="path">The checkpoint file</param>
+	/// <param name="name">The name of the generator, which a checkpoint must match to be resumed</param>
+	/// <param name="length">The number of digits in the permutation</param>
+	/// <param name="intervalSeconds">The time between checkpoints</param>
+	SearchCheckpoint(std::string path, std::string name, int length, int intervalSeconds = CHECKPOINT_INTERVAL_SECONDS)
+		: path(path), name(name), length(length), interval(intervalSeconds), writer(nullptr)
+	{
+		resumeAt.rows = 0;
+		resumeAt.bytes = 0;
+		lastSave = std::chrono::steady_clock::now();
+	}
+
+	/// <summary>
+	/// Reads the checkpoint file, if there is one. In an instrumented build the saved
+	/// counters are added back to the totals. A parallel search saves the counters of
+	/// tasks that finished but were not written yet, so those tasks count twice.
+	/// </summary>
+	/// <param name="permutation">Set to the permutation to resume from</param>
+	/// <returns>False if there is no checkpoint file</returns>
+	bool load(int* permutation)
+	{
+		std::ifstream file(path);
+		if (!file.is_open())
+			return false;
+		std::string key;
+		int version = 0;
+		file >> key >> version;
+		if (key != "checkpoint" || version != CHECKPOINT_VERSION)
+			throw std::runtime_error(path + " is not a checkpoint file");
+
+		bool hasPosition = false;
+		while (file >> key)
+		{
+			if (key == "generator")
+			{
+				std::string generator;
+				file >> generator;
+				if (generator != name)
+					throw std::runtime_error(path + " is a checkpoint of " + generator + ", not " + name);
+			}
+			else if (key == "position")
+			{
+				int count = 0;
+				file >> count;
+				if (count != length)
+					throw std::runtime_error(path + " has a permutation of the wrong length");
+				for (int i = 0; i < length; i++)
+					file >> permutation[i];
+				hasPosition = true;
+			}
+			else if (key == "rows")
+				file >> resumeAt.rows;
+			else if (key == "bytes")
+				file >> resumeAt.bytes;
+#ifdef BAUER_INSTRUMENT
+			else if (key == "nodes" || key == "prunes")
+			{
+				SearchStats& stats = totalSearchStats();
+				uint64_t* counts = key == "nodes" ? stats.nodes : stats.prunes;
+				for (int i = 0; i < STATS_DEPTHS; i++)
+				{
+					uint64_t count = 0;
+					file >> count;
+					counts[i] += count;
+				}
+			}
+			else if (key == "leaves" || key == "solutions")
+			{
+				uint64_t count = 0;
+				file >> count;
+				(key == "leaves" ? totalSearchStats().leaves : totalSearchStats().solutions) += count;
+			}
+#endif
+			else
+			{
+				// the counters of an instrumented build, which this build does not keep
+				std::string rest;
+				std::getline(file, rest);
+			}
+			if (file.fail())
+				throw std::runtime_error(path + " is damaged");
+		}
+		if (!hasPosition || resumeAt.bytes == 0)
+			throw std::runtime_error(path + " is damaged");
+		return true;
+	}
+
+	/// <summary>
+	/// Gets how much of the output file the loaded checkpoint had written
+	/// </summary>
+	/// <returns>The position, or zero if no checkpoint was loaded</returns>
+	RowFilePosition output() const
+	{
+		return resumeAt;
+	}
+
+	/// <summary>
+	/// Sets the writer whose file the checkpoints describe
+	/// </summary>
+	/// <param name="rowWriter">The writer of the output file</param>
+	void attach(RowFileWriter& rowWriter)
+	{
+		writer = &rowWriter;
+	}
+
+	/// <summary>
+	/// Saves a checkpoint if the interval has passed since the last one
+	/// </summary>
+	/// <param name="permutation">A permutation with every valid row before it written, and none after it</param>
+	void update(const int* permutation)
+	{
+		if (std::chrono::steady_clock::now() - lastSave >= interval)
+			save(permutation);
+	}
+
+	/// <summary>
+	/// Saves a checkpoint
+	/// </summary>
+	/// <param name="permutation">A permutation with every valid row before it written, and none after it</param>
+	void save(const int* permutation)
+	{
+		RowFilePosition position = writer->sync();
+		std::ostringstream text;
+		text << "checkpoint " << CHECKPOINT_VERSION << "\n";
+		text << "generator " << name << "\n";
+		text << "position " << length;
+		for (int i = 0; i < length; i++)
+			text << " " << permutation[i];
+		text << "\n";
+		text << "rows " << position.rows << "\n";
+		text << "bytes " << position.bytes << "\n";
+#ifdef BAUER_INSTRUMENT
+		mergeSearchStats();
+		{
+			std::lock_guard<std::mutex> guard(totalSearchStatsLock());
+			writeCheckpointCounts(text, "nodes", totalSearchStats().nodes);
+			writeCheckpointCounts(text, "prunes", totalSearchStats().prunes);
+			text << "leaves " << totalSearchStats().leaves << "\n";
+			text << "solutions " << totalSearchStats().solutions << "\n";
+		}
+#endif
+		replaceFile(text.str());
+		lastSave = std::chrono::steady_clock::now();
+	}
+
+	/// <summary>
+	/// Deletes the checkpoint file of a search that finished. Call it after the output
+	/// file is closed. A search that never saved a checkpoint has no file to delete.
+	/// </summary>
+	void finish()
+	{
+		std::remove(path.c_str());
+	}
+
+private:
+	std::string path;
+	std::string name;
+	int length;
+	std::chrono::seconds interval;
+	std::chrono::steady_clock::time_point lastSave;
+	RowFileWriter* writer;
+	RowFilePosition resumeAt;
+
+	/// <summary>
+	/// Writes the checkpoint file by writing a temporary file and moving it over the old one.
+	/// The temporary file reaches the disk before the move, so a crash cannot leave an empty
+	/// or partial checkpoint in place of the old one.
+	/// </summary>
+	/// <param name="contents">The text of the checkpoint</param>
+	void replaceFile(const std::string& contents)
+	{
+		std::string temporary = path + ".tmp";
+		FILE* file = std::fopen(temporary.c_str(), "w");
+		bool written = file != nullptr && std::fwrite(contents.data(), 1, contents.size(), file) == contents.size() && std::fflush(file) == 0;
+#ifdef _WIN32
+		written = written && _commit(_fileno(file)) == 0;
+#else
+		written = written && fsync(fileno(file)) == 0;
+#endif
+		if (file != nullptr && std::fclose(file) != 0)
+			written = false;
+		if (!written)
+			throw std::runtime_error("Could not write " + temporary);
+#ifdef _WIN32
+		bool replaced = MoveFileExA(temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+		bool replaced = std::rename(temporary.c_str(), path.c_str()) == 0;
+#endif
+		if (!replaced)
+			throw std::runtime_error("Could not replace " + path);
+
+#ifndef _WIN32
+		// the move itself lasts only once the directory is flushed too. Some file systems
+		// cannot flush a directory, but then a crash still leaves the old checkpoint or the
+		// new one, both complete.
+		size_t separator = path.find_last_of('/');
+		std::string directory = separator == std::string::npos ? "." : separator == 0 ? "/" : path.substr(0, separator);
+		int descriptor = open(directory.c_str(), O_RDONLY);
+		if (descriptor >= 0)
+		{
+			fsync(descriptor);
+			close(descriptor);
+		}
+#endif
+	}
+
+#ifdef BAUER_INSTRUMENT
+	static void writeCheckpointCounts(std::ostringstream& text, const char* key, const uint64_t* counts)
+	{
+		text << key;
+		for (int i = 0; i < STATS_DEPTHS; i++)
+			text << " " << counts[i];
+		text << "\n";
+	}
+#endif
+};
+
+/// <summary>
+/// Wraps a predicate so that a serial search saves checkpoints as it goes. The search
+/// writes each valid row before moving on, so the permutation being tested is always
+/// a point a resumed search can start from.
+/// </summary>
+/// <typeparam name="Predicate">The type of the predicate</typeparam>
+template <typename Predicate>
+struct CheckpointPredicate
+{
+	Predicate isValid;
+	SearchCheckpoint* checkpoint;
+	int calls;
+
+	CheckpointPredicate(const Predicate& isValid, SearchCheckpoint& checkpoint) : isValid(isValid), checkpoint(&checkpoint), calls(0) {}
+
+	/// <summary>
+	/// Calls the predicate, and now and then saves a checkpoint at the permutation
+	/// </summary>
+	/// <param name="permutation">The permutation</param>
+	/// <param name="from">The index of the first digit that changed since the last call</param>
+	/// <returns>The result of the predicate</returns>
+	int operator()(int* permutation, int from)
+	{
+		if (++calls == CHECKPOINT_CLOCK_CALLS)
+		{
+			calls = 0;
+			checkpoint->update(permutation);
+		}
+		return isValid(permutation, from);
+	}
+};
+
+#endif
@@ -0,0 +1,520 @@
+/*
+* File: bauer_constraint.h
+* Author: Jeff Martin
+*
+* This file contains a small language for describing kinds of twelve-tone
+* rows, and a predicate that searches for them. A description is a list of
+* clauses, one per line or separated by semicolons:
+*
+*   chords 3|4|5 [linear|cyclic] [distinct] [exclude SET ...] [require SET ...]
+*   intervals [linear|cyclic] [distinct] [exclude N ...] [require N ...]
+*   hexachord SET ... | combinatorial
+*
+* A chords clause is about the imbricated chords of one size, and an
+* intervals clause about the intervals between adjacent pcs. Cyclic adds the
+* chords or interval that wrap around from the end of the row. Distinct means
+* no two are in the same set class, or are the same interval, exclude names
+* the classes or intervals that may not appear, and require the ones that
+* must. A hexachord clause says the first hexachord is in one of the set
+* classes given, or that its complement is an inversion of it. A SET is
+* written as its pcs, such as 036 or 02468T, with T and E for 10 and 11.
+*
+* The clauses are compiled into a list of checks for each index of the row,
+* and each check runs at the first index where it can fail: a chord when its
+* last pc is placed, a required class when too few chords are left to supply
+* it, and a hexachord when the pcs so far are in no allowed hexachord. So a
+* new kind of row gets the same skip-ahead search as the hand-written
+* predicates. The all-trichord rows, for example, are "chords 3 cyclic
+* distinct", and the Babbitt rows are "chords 3 distinct exclude 036 048".
+* Every clause is unchanged by transposition, so the rows that begin with 0
+* stand for all of them.
+*
+* Copyright  2022 by Jeffrey Martin. All rights reserved.
+* Email: jmartin@jeffreymartincomposer.com
+* Website: https://jeffreymartincomposer.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BAUERCONSTRAINT
+#define BAUERCONSTRAINT
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "bauer_binary.h"
+#include "bauer_engine.h"
+#include "bauer_parallel.h"
+#include "bauer_setclass.h"
+
+// the most chords and intervals clauses in one description
+const int CONSTRAINT_SLOTS = 4;
+
+// the descriptions of the kinds of row the hand-written predicates find
+const char* const ALL_TRICHORD_CONSTRAINTS = "chords 3 cyclic distinct";
+const char* const BABBITT_TRICHORD_CONSTRAINTS = "chords 3 distinct exclude 036 048";
+const char* const TEN_TRICHORD_CONSTRAINTS = "chords 3 distinct";
+
+/// <summary>
+/// The kinds of check a description compiles to
+/// </summary>
+enum ConstraintCheckKind
+{
+	// the set class of one imbricated chord
+	CHECK_CHORD,
+
+	// one interval between adjacent pcs
+	CHECK_INTERVAL,
+
+	// enough chords or intervals are left to supply the required ones
+	CHECK_REQUIRED,
+
+	// the pcs so far are in some allowed first hexachord
+	CHECK_HEXACHORD
+};
+
+/// <summary>
+/// One check, run when the pc at its index is placed
+/// </summary>
+struct ConstraintCheck
+{
+	ConstraintCheckKind kind;
+
+	// the bitmask of classes or intervals the check reads and adds to
+	int slot;
+
+	// the index of the first interval of the chord, or of the interval
+	int start;
+
+	// the number of pcs in the chord
+	int size;
+
+	// true if the class or interval may not repeat
+	bool distinct;
+
+	// the classes or intervals that may not appear, and the ones that must
+	uint64_t excluded;
+	uint64_t required;
+
+	// the number of chords or intervals of the clause that come after this index
+	int remaining;
+};
+
+/// <summary>
+/// A compiled description of a kind of row
+/// </summary>
+struct RowConstraints
+{
+	// the checks of each index, with the checks of index i from first[i] up to first[i + 1]
+	std::vector<ConstraintCheck> checks;
+	int first[13];
+
+	// the number of bitmasks of classes or intervals the checks use
+	int slots;
+
+	// for each set of pcs, true if some allowed first hexachord contains it
+	std::vector<bool> hexachords;
+};
+
+RowConstraints compileRowConstraints(std::string text);
+void generateConstrainedRows(std::string destinationFile, std::string name, std::string constraints, unsigned int threads = 1);
+static void compileConstraintClause(std::istringstream& words, std::string clause, bool chords, std::vector<ConstraintCheck> (&checks)[12], int& slots);
+static int countPcs(int set);
+static int parsePcSet(std::string word);
+static std::vector<bool> listSetClass(int set);
+
+/// <summary>
+/// Determines if a twelve-tone row is of the kind a compiled description describes.
+/// It remembers the classes and intervals seen up to each index of the last row it
+/// checked, so only the checks of the changed suffix are run again.
+/// </summary>
+struct ConstraintPredicate
+{
+	const RowConstraints* constraints;
+
+	// the intervals of the row, with the first four repeated after the one that wraps around
+	int intervals[16];
+
+	// the classes or intervals of each slot, and the pcs, seen before each index
+	uint64_t seen[13][CONSTRAINT_SLOTS];
+	int pcs[13];
+
+	// the number of indexes whose state above is current
+	int checked;
+
+	ConstraintPredicate(const RowConstraints& constraints) : constraints(&constraints), checked(0)
+	{
+		for (int i = 0; i < CONSTRAINT_SLOTS; i++)
+			seen[0][i] = 0;
+		pcs[0] = 0;
+	}
+
+	/// <summary>
+	/// Determines if a twelve-tone row is of the kind
+	/// </summary>
+	/// <param name="permutation">A twelve-tone row</param>
+	/// <param name="from">The index of the first pc that changed since the last call</param>
+	/// <returns>The index of the pc that failed, or -1 if the row is of the kind</returns>
+	int operator()(int* permutation, int from)
+	{
+		if (from < checked)
+			checked = from;
+		for (int i = checked; i < 12; i++)
+		{
+			// interval i - 1 ends at pc i, and the interval that wraps around ends at the last pc
+			if (i > 0)
+			{
+				intervals[i - 1] = permutation[i] - permutation[i - 1];
+				if (intervals[i - 1] < 0)
+					intervals[i - 1] += 12;
+			}
+			if (i == 11)
+			{
+				intervals[11] = permutation[0] - permutation[11];
+				if (intervals[11] < 0)
+					intervals[11] += 12;
+				for (int j = 0; j < 4; j++)
+					intervals[12 + j] = intervals[j];
+			}
+			pcs[i + 1] = pcs[i] | (1 << permutation[i]);
+			uint64_t* current = seen[i + 1];
+			for (int j = 0; j < constraints->slots; j++)
+				current[j] = seen[i][j];
+
+			for (int k = constraints->first[i]; k < constraints->first[i + 1]; k++)
+			{
+				const ConstraintCheck& check = constraints->checks[k];
+				if (check.kind == CHECK_HEXACHORD)
+				{
+					if (!constraints->hexachords[pcs[i + 1]])
+					{
+						checked = i;
+						return i;
+					}
+				}
+				else if (check.kind == CHECK_REQUIRED)
+				{
+					// each chord or interval still to come can supply at most one
+					int missing = 0;
+					for (uint64_t left = check.required & ~current[check.slot]; left; left &= left - 1)
+						missing++;
+					if (missing > check.remaining)
+					{
+						checked = i;
+						return i;
+					}
+				}
+				else
+				{
+					int value = intervals[check.start];
+					if (check.kind == CHECK_CHORD)
+					{
+						const int* spacing = &intervals[check.start];
+						if (check.size == 3)
+							value = trichordClass(spacing[0], spacing[1]);
+						else if (check.size == 4)
+							value = tetrachordClass(spacing[0], spacing[1], spacing[2]);
+						else
+							value = pentachordClass(spacing[0], spacing[1], spacing[2], spacing[3]);
+					}
+					uint64_t bit = (uint64_t)1 << value;
+					if ((check.excluded & bit) || (check.distinct && (current[check.slot] & bit)))
+					{
+						checked = i;
+						return i;
+					}
+					current[check.slot] |= bit;
+				}
+			}
+		}
+		checked = 12;
+		return -1;
+	}
+};
+
+/// <summary>
+/// Generates the twelve-tone rows beginning with 0 that a description describes
+/// </summary>
+/// <param name="destinationFile">The destination file, in binary if it ends in .bin and in JSON otherwise</param>
+/// <param name="name">The name to write the rows under</param>
+/// <param name="constraints">The description of the rows</param>
+/// <param name="threads">The number of threads to search with, or 0 to use every hardware thread</param>
+void generateConstrainedRows(std::string destinationFile, std::string name, std::string constraints, unsigned int threads)
+{
+	RowConstraints compiled = compileRowConstraints(constraints);
+	RowFileWriter writer(destinationFile, name, 12, 12);
+	BAUER_COUNT(resetSearchStats());
+
+	std::cout << "Starting...\n";
+	// every row that begins with 0, which ends at 1...
+	const int endPrefix[1] = { 1 };
+	if (threads != 1)
+		searchParallel<12, 0>(ConstraintPredicate(compiled), endPrefix, 1, threads, writer);
+	else
+	{
+		int permutation[12];
+		for (int i = 0; i < 12; i++)
+			permutation[i] = i;
+		ConstraintPredicate isValid(compiled);
+		bool more = seekRow<12, 0>(permutation, isValid);
+		while (more && permutation[0] == 0)
+		{
+			writer.write(permutation);
+			more = nextRow<12, 0>(permutation, isValid);
+		}
+	}
+
+	// finish the file
+	writer.close();
+	BAUER_COUNT(finishSearchStats(destinationFile + ".stats.json"));
+
+	std::cout << "Done. Found " << writer.count() << " rows.\n";
+}
+
+/// <summary>
+/// Compiles a description of a kind of row into checks
+/// </summary>
+/// <param name="text">The clauses of the description, one per line or separated by semicolons</param>
+/// <returns>The compiled description</returns>
+RowConstraints compileRowConstraints(std::string text)
+{
+	std::vector<ConstraintCheck> checks[12];
+	int slots = 0;
+	std::vector<bool> hexachords(4096, true);
+	bool hasHexachords = false;
+
+	size_t begin = 0;
+	while (begin <= text.size())
+	{
+		size_t end = text.find_first_of(";\n", begin);
+		if (end == std::string::npos)
+			end = text.size();
+		std::string clause = text.substr(begin, end - begin);
+		begin = end + 1;
+
+		std::istringstream words(clause);
+		std::string word;
+		if (!(words >> word))
+			continue;
+		if (word == "hexachord")
+		{
+			// each hexachord clause narrows the allowed hexachords
+			std::vector<bool> allowed(4096, false);
+			bool any = false;
+			while (words >> word)
+			{
+				any = true;
+				if (word == "combinatorial")
+				{
+					// the complement of the hexachord is an inversion of it
+					for (int set = 0; set < 4096; set++)
+					{
+						for (int shift = 0; shift < 12 && !allowed[set]; shift++)
+							allowed[set] = transformSet(set, shift, true) == (~set & 0xfff);
+					}
+				}
+				else
+				{
+					int set = parsePcSet(word);
+					if (set < 0 || countPcs(set) != 6)
+						throw std::invalid_argument("\"" + word + "\" is not a hexachord in \"" + clause + "\"");
+					std::vector<bool> members = listSetClass(set);
+					for (int i = 0; i < 4096; i++)
+						allowed[i] = allowed[i] || members[i];
+				}
+			}
+			if (!any)
+				throw std::invalid_argument("\"" + clause + "\" does not name any hexachords");
+			for (int set = 0; set < 4096; set++)
+				hexachords[set] = hexachords[set] && allowed[set];
+			hasHexachords = true;
+		}
+		else if (word == "chords" || word == "intervals")
+			compileConstraintClause(words, clause, word == "chords", checks, slots);
+		else
+			throw std::invalid_argument("\"" + clause + "\" does not begin with chords, intervals or hexachord");
+	}
+
+	RowConstraints compiled;
+	compiled.slots = slots;
+	compiled.hexachords.assign(4096, !hasHexachords);
+	if (hasHexachords)
+	{
+		// a set of pcs can still be finished if some allowed hexachord contains it
+		for (int set = 0; set < 4096; set++)
+		{
+			if (!hexachords[set] || countPcs(set) != 6)
+				continue;
+			for (int subset = set; ; subset = (subset - 1) & set)
+			{
+				compiled.hexachords[subset] = true;
+				if (subset == 0)
+					break;
+			}
+		}
+		for (int i = 0; i < 6; i++)
+		{
+			ConstraintCheck check = {};
+			check.kind = CHECK_HEXACHORD;
+			checks[i].push_back(check);
+		}
+	}
+
+	for (int i = 0; i < 12; i++)
+	{
+		compiled.first[i] = (int)compiled.checks.size();
+		compiled.checks.insert(compiled.checks.end(), checks[i].begin(), checks[i].end());
+	}
+	compiled.first[12] = (int)compiled.checks.size();
+	return compiled;
+}
+
+/// <summary>
+/// Compiles a chords or intervals clause into checks at the indexes where each chord or interval is complete
+/// </summary>
+/// <param name="words">The words of the clause after the first</param>
+/// <param name="clause">The clause, for error messages</param>
+/// <param name="chords">True for a chords clause, false for an intervals clause</param>
+/// <param name="checks">The checks of each index, to add to</param>
+/// <param name="slots">The number of slots in use, which the clause adds one to</param>
+static void compileConstraintClause(std::istringstream& words, std::string clause, bool chords, std::vector<ConstraintCheck> (&checks)[12], int& slots)
+{
+	if (slots == CONSTRAINT_SLOTS)
+		throw std::invalid_argument("A description can have at most " + std::to_string(CONSTRAINT_SLOTS) + " chords and intervals clauses");
+
+	ConstraintCheck check = {};
+	check.kind = chords ? CHECK_CHORD : CHECK_INTERVAL;
+	check.slot = slots++;
+	check.size = 2;
+	std::string word;
+	if (chords)
+	{
+		if (!(words >> word) || (word != "3" && word != "4" && word != "5"))
+			throw std::invalid_argument("The chord size must be 3, 4 or 5 in \"" + clause + "\"");
+		check.size = word[0] - '0';
+	}
+
+	// the words after exclude or require are classes or intervals, until the next keyword
+	bool cyclic = false;
+	uint64_t* list = nullptr;
+	while (words >> word)
+	{
+		if (word == "linear" || word == "cyclic")
+			cyclic = word == "cyclic";
+		else if (word == "distinct")
+			check.distinct = true;
+		else if (word == "exclude")
+			list = &check.excluded;
+		else if (word == "require")
+			list = &check.required;
+		else if (list == nullptr)
+			throw std::invalid_argument("\"" + word + "\" is not understood in \"" + clause + "\"");
+		else if (chords)
+		{
+			int set = parsePcSet(word);
+			if (set < 0 || countPcs(set) != check.size)
+				throw std::invalid_argument("\"" + word + "\" is not a chord of " + std::to_string(check.size) + " pcs in \"" + clause + "\"");
+			*list |= (uint64_t)1 << setClass(set);
+		}
+		else
+		{
+			size_t used = 0;
+			int interval = -1;
+			try
+			{
+				interval = std::stoi(word, &used);
+			}
+			catch (const std::logic_error&)
+			{
+			}
+			if (used != word.size() || interval < 1 || interval > 11)
+				throw std::invalid_argument("\"" + word + "\" is not an interval from 1 to 11 in \"" + clause + "\"");
+			*list |= (uint64_t)1 << interval;
+		}
+	}
+
+	// the chord or interval that starts at pc i ends at pc i + size - 1, and the ones
+	// that wrap around end at the last pc
+	int count = cyclic ? 12 : 13 - check.size;
+	int ends[12];
+	for (int start = 0; start < count; start++)
+	{
+		ConstraintCheck item = check;
+		item.start = start;
+		ends[start] = start + check.size - 1 < 12 ? start + check.size - 1 : 11;
+		checks[ends[start]].push_back(item);
+	}
+
+	// a required class or interval can still appear if enough of them are left after each index
+	if (check.required != 0)
+	{
+		for (int i = 0, done = 0; i < 12; i++)
+		{
+			while (done < count && ends[done] <= i)
+				done++;
+			ConstraintCheck required = check;
+			required.kind = CHECK_REQUIRED;
+			required.remaining = count - done;
+			checks[i].push_back(required);
+		}
+	}
+}
+
+/// <summary>
+/// Counts the pcs in a set
+/// </summary>
+/// <param name="set">The bitmask of the set</param>
+/// <returns>The number of pcs</returns>
+static int countPcs(int set)
+{
+	int count = 0;
+	for (; set; set &= set - 1)
+		count++;
+	return count;
+}
+
+/// <summary>
+/// Reads a set of pcs written as digits, with T or A for 10 and E or B for 11
+/// </summary>
+/// <param name="word">The pcs</param>
+/// <returns>The bitmask of the set, or -1 if the word is not a set of different pcs</returns>
+static int parsePcSet(std::string word)
+{
+	int set = 0;
+	for (char c : word)
+	{
+		int pc = c >= '0' && c <= '9' ? c - '0' : c == 'T' || c == 'A' ? 10 : c == 'E' || c == 'B' ? 11 : -1;
+		if (pc < 0 || ((set >> pc) & 1))
+			return -1;
+		set |= 1 << pc;
+	}
+	return word.empty() ? -1 : set;
+}
+
+/// <summary>
+/// Lists the sets in the set class of a set
+/// </summary>
+/// <param name="set">The bitmask of the set</param>
+/// <returns>True for each set that is a transposition or inversion of the set</returns>
+static std::vector<bool> listSetClass(int set)
+{
+	std::vector<bool> members(4096, false);
+	for (int shift = 0; shift < 24; shift++)
+		members[transformSet(set, shift % 12, shift >= 12)] = true;
+	return members;
+}
+
+#endif
@@ -0,0 +1,257 @@
+/*
+* File: bauer_count.h
+* Author: Jeff Martin
+*
+* This file contains a counting mode for the all-interval search. It counts
+* the row generators of an even equal temperament without storing or writing
+* them. A partial generator is fully described by the pcs it has reached and
+* the intervals it has used, since the current pc is the sum of those
+* intervals. The number of ways to complete a partial generator depends only
+* on that state, so it is counted once and remembered. Multiplying every pc
+* and interval by a unit of the modulus, a number with no factor in common
+* with it, keeps pc 0 and the tritone in place and maps the completions of one
+* state onto those of another. So each state is remembered as the smallest of
+* its multiples, and the states of a multiple share one count.
+*
+* The gain is modest. Few states repeat, so the memo makes the count only
+* three to five times faster than enumerating the generators (0.7 s against
+* 3.6 s at modulus 16, and 63 s against 190 s at modulus 18). The time still
+* grows exponentially with the modulus, so a modulus that is out of reach of
+* the enumerator stays out of reach here. The trichord searches are counted
+* by countAllTrichordRows and its neighbours, which run the search into a
+* RowCounter, since the whole search takes well under a second.
+*
+* Copyright  2022 by Jeffrey Martin. All rights reserved.
+* Email: jmartin@jeffreymartincomposer.com
+* Website: https://jeffreymartincomposer.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BAUERCOUNT
+#define BAUERCOUNT
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "bauer_engine.h"
+
+/// <summary>
+/// A fixed-size table of completion counts by state. Each state has one slot, chosen by
+/// a hash, and a newer state takes the slot over. Forgetting a count only means that it
+/// is counted again, so the memory stays bounded for any modulus.
+/// </summary>
+class CompletionCountTable
+{
+public:
+	/// <summary>
+	/// Creates an empty table
+	/// </summary>
+	/// <param name="bits">The base 2 logarithm of the number of slots</param>
+	CompletionCountTable(int bits) : states((size_t)1 << bits, 0), counts((size_t)1 << bits), shift(64 - bits) {}
+
+	/// <summary>
+	/// Looks up the count of a state
+	/// </summary>
+	/// <param name="state">The state, which must not be 0</param>
+	/// <param name="count">The count, if it is known</param>
+	/// <returns>True if the count is known</returns>
+	bool find(uint64_t state, uint64_t& count) const
+	{
+		size_t slot = index(state);
+		if (states[slot] != state)
+			return false;
+		count = counts[slot];
+		return true;
+	}
+
+	/// <summary>
+	/// Remembers the count of a state
+	/// </summary>
+	/// <param name="state">The state, which must not be 0</param>
+	/// <param name="count">The count</param>
+	void store(uint64_t state, uint64_t count)
+	{
+		size_t slot = index(state);
+		states[slot] = state;
+		counts[slot] = count;
+	}
+
+private:
+	std::vector<uint64_t> states;
+	std::vector<uint64_t> counts;
+	int shift;
+
+	size_t index(uint64_t state) const
+	{
+		// Fibonacci hashing spreads the bits of the state over the top bits
+		return (size_t)((state * 0x9E3779B97F4A7C15ull) >> shift);
+	}
+};
+
+/// <summary>
+/// The multiplications of the pcs and intervals of a modulus by its units. Each maps a
+/// bitmask of pcs or intervals below 32 through four lookups, one for each byte.
+/// </summary>
+class UnitMultipliers
+{
+public:
+	/// <summary>
+	/// Builds the lookups for every unit of a modulus
+	/// </summary>
+	/// <param name="modulus">The number of notes in the octave, no more than 32</param>
+	UnitMultipliers(int modulus) : units(0)
+	{
+		for (int unit = 1; unit < modulus; unit++)
+		{
+			int a = unit, b = modulus;
+			while (b)
+			{
+				int remainder = a % b;
+				a = b;
+				b = remainder;
+			}
+			if (a != 1)
+				continue;
+
+			for (int byte = 0; byte < 4; byte++)
+			{
+				for (int bits = 0; bits < 256; bits++)
+				{
+					uint32_t image = 0;
+					for (int i = 0; i < 8 && byte * 8 + i < modulus; i++)
+					{
+						if (bits & (1 << i))
+							image |= (uint32_t)1 << (unit * (byte * 8 + i) % modulus);
+					}
+					lookups.push_back(image);
+				}
+			}
+			units++;
+		}
+	}
+
+	/// <summary>
+	/// Finds the smallest multiple of a state
+	/// </summary>
+	/// <param name="reached">A bitmask of the pcs reached</param>
+	/// <param name="unused">A bitmask of the intervals not used</param>
+	/// <returns>The smallest of the multiples, with the pcs in the low 32 bits and the intervals in the high 32 bits</returns>
+	uint64_t smallest(uint64_t reached, uint64_t unused) const
+	{
+		uint64_t best = UINT64_MAX;
+		for (int unit = 0; unit < units; unit++)
+		{
+			uint64_t state = multiply(unit, (uint32_t)reached) | (uint64_t)multiply(unit, (uint32_t)unused) << 32;
+			if (state < best)
+				best = state;
+		}
+		return best;
+	}
+
+private:
+	std::vector<uint32_t> lookups;
+	int units;
+
+	uint32_t multiply(int unit, uint32_t bits) const
+	{
+		const uint32_t* lookup = &lookups[(size_t)unit * 1024];
+		return lookup[bits & 0xFF] | lookup[256 + (bits >> 8 & 0xFF)] | lookup[512 + (bits >> 16 & 0xFF)] | lookup[768 + (bits >> 24)];
+	}
+};
+
+uint64_t countAllIntervalRowGenerators();
+static uint64_t countIntervalRowCompletions(const UnitMultipliers& units, int modulus, int depth, int sum, uint64_t reached, uint64_t unused, CompletionCountTable& counts);
+uint64_t countIntervalRowGenerators(int modulus);
+
+/// <summary>
+/// Counts the eleven-interval row generators that begin with an interval smaller than 6.
+/// These are the generators that generateAllIntervalRowGenerators finds.
+/// </summary>
+/// <returns>The number of row generators</returns>
+uint64_t countAllIntervalRowGenerators()
+{
+	return countIntervalRowGenerators(12);
+}
+
+/// <summary>
+/// Counts the all-interval row generators of an even equal temperament that begin with
+/// an interval smaller than half the octave. These are the generators that
+/// generateIntervalRowGenerators finds, and half of all the all-interval rows that begin with 0.
+/// </summary>
+/// <param name="modulus">The number of notes in the octave, an even number from 4 to 32</param>
+/// <returns>The number of row generators</returns>
+uint64_t countIntervalRowGenerators(int modulus)
+{
+	// the pcs reached and the intervals unused share one 64-bit state
+	if (modulus < 4 || modulus > 32 || modulus % 2 != 0)
+		throw std::invalid_argument("The modulus must be an even number from 4 to 32");
+
+	uint64_t unused = 0;
+	for (int interval = 1; interval < modulus; interval++)
+		unused |= (uint64_t)1 << interval;
+
+	// pc 0 is reached before the first interval. The table grows with the modulus, up
+	// to 256 MB, since a table too small for the states that repeat is slower than none.
+	UnitMultipliers units(modulus);
+	CompletionCountTable counts(modulus > 16 ? 24 : modulus > 12 ? 22 : 16);
+	return countIntervalRowCompletions(units, modulus, 0, 0, 1, unused, counts);
+}
+
+/// <summary>
+/// Counts the ways to complete a partial row generator
+/// </summary>
+/// <param name="units">The multiplications by the units of the modulus</param>
+/// <param name="modulus">The number of notes in the octave</param>
+/// <param name="depth">The number of intervals in the partial generator</param>
+/// <param name="sum">The pc reached by the intervals so far</param>
+/// <param name="reached">A bitmask of the pcs reached so far</param>
+/// <param name="unused">A bitmask of the intervals not used yet</param>
+/// <param name="counts">The counts already known, by state</param>
+/// <returns>The number of complete generators that begin with the partial generator</returns>
+static uint64_t countIntervalRowCompletions(const UnitMultipliers& units, int modulus, int depth, int sum, uint64_t reached, uint64_t unused, CompletionCountTable& counts)
+{
+	// the last interval is forced, and it always reaches the tritone
+	if (depth == modulus - 2)
+		return 1;
+
+	// Every multiple reaches pc 0, so the state is never 0. The first position has its
+	// own bound, so it is not remembered, and near the end it is cheaper to count again
+	// than to look up.
+	bool remember = depth > 0 && depth < modulus - 4;
+	uint64_t state = remember ? units.smallest(reached, unused) : 0;
+	uint64_t total = 0;
+	if (remember && counts.find(state, total))
+		return total;
+
+	// the tritone can only be the last pc reached, and generators beginning with a
+	// tritone or more are inversions of ones we count
+	int tritone = modulus / 2;
+	uint64_t candidates = depth == 0 ? unused & (((uint64_t)1 << tritone) - 1) : unused;
+	while (candidates)
+	{
+		int interval = lowestDigitWide(candidates);
+		candidates &= candidates - 1;
+		int pc = sum + interval;
+		if (pc >= modulus)
+			pc -= modulus;
+		if (((reached >> pc) & 1) || pc == tritone)
+			continue;
+		total += countIntervalRowCompletions(units, modulus, depth + 1, pc, reached | ((uint64_t)1 << pc), unused & ~((uint64_t)1 << interval), counts);
+	}
+	if (remember)
+		counts.store(state, total);
+	return total;
+}
+
+#endif
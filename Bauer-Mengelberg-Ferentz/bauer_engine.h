@@ -0,0 +1,166 @@
+/*
+* File: bauer_engine.h
+* Author: Jeff Martin
+*
+* This file contains the skip-ahead lexicographic enumerator shared by the
+* all-interval and trichord adaptations of the Bauer-Mengelberg-Ferentz
+* algorithm. Each search supplies the row length, the smallest digit of its
+* alphabet and a validity predicate as template arguments, so every search
+* gets its own fully inlined copy of the enumerator. The digits that are free
+* to be placed are kept in a bitmask, so finding the next larger digit and
+* rebuilding the ascending suffix are bit operations rather than scans.
+*
+* Copyright  2022 by Jeffrey Martin. All rights reserved.
+* Email: jmartin@jeffreymartincomposer.com
+* Website: https://jeffreymartincomposer.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BAUERENGINE
+#define BAUERENGINE
+#include <cstdint>
+#include "bauer_stats.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/// <summary>
+/// Finds the smallest digit in a nonzero bitmask of digits
+/// </summary>
+/// <param name="digits">A bitmask with bit d set for each digit d</param>
+/// <returns>The smallest digit</returns>
+inline int lowestDigit(unsigned int digits)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, digits);
+	return (int)index;
+#else
+	return __builtin_ctz(digits);
+#endif
+}
+
+/// <summary>
+/// Finds the smallest digit in a nonzero 64-bit bitmask of digits
+/// </summary>
+/// <param name="digits">A bitmask with bit d set for each digit d</param>
+/// <returns>The smallest digit</returns>
+inline int lowestDigitWide(uint64_t digits)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	if (_BitScanForward(&index, (unsigned long)digits))
+		return (int)index;
+	_BitScanForward(&index, (unsigned long)(digits >> 32));
+	return (int)index + 32;
+#else
+	return __builtin_ctzll(digits);
+#endif
+}
+
+/// <summary>
+/// Updates a permutation of the digits First ... First + Length - 1 to the next
+/// permutation (in lexicographic order) that the predicate accepts. The predicate
+/// is called with the permutation and the index of the first digit that changed
+/// since its previous call, so it can keep state for the unchanged prefix. It
+/// returns the index of the digit that failed, or -1 if the permutation is valid.
+/// Every permutation that shares the digits up to and including the failed index
+/// is skipped. A failure index of Length or greater means that no prefix failed,
+/// so only the current permutation is skipped. The search can be kept to the
+/// permutations that begin with the current first few digits.
+/// </summary>
+/// <typeparam name="Length">The number of digits in the permutation</typeparam>
+/// <typeparam name="First">The smallest digit in the permutation</typeparam>
+/// <param name="permutation">The permutation</param>
+/// <param name="isValid">The validity predicate</param>
+/// <param name="failedIndex">The failure index of the current permutation, if it is already known</param>
+/// <param name="fixedDigits">The number of leading digits that may not change</param>
+/// <returns>False if there are no more valid permutations that begin with the fixed digits</returns>
+template <int Length, int First, typename Predicate>
+inline bool nextRow(int* permutation, Predicate& isValid, int failedIndex = -1, int fixedDigits = 0)
+{
+	static_assert(First + Length < 32, "the digits must fit in a 32-bit mask");
+
+	// unless told otherwise, assume that the permutation is valid
+	int validPermutation = failedIndex;
+
+	do
+	{
+		// If we don't have a critical index already, the critical digit is the last digit
+		// that is smaller than some digit to its right. It cannot be the last digit.
+		// If we do, the critical digit is the digit that failed, unless no digit to its
+		// right is larger, in which case we keep looking to the left.
+		int criticalIndex = validPermutation == -1 || validPermutation > Length - 1 ? Length - 2 : validPermutation;
+
+		// the digits to the right of the critical digit
+		unsigned int available = 0;
+		for (int i = criticalIndex + 1; i < Length; i++)
+			available |= 1u << permutation[i];
+
+		for (; criticalIndex >= fixedDigits; criticalIndex--)
+		{
+			available |= 1u << permutation[criticalIndex];
+			unsigned int larger = available & (~0u << (permutation[criticalIndex] + 1));
+
+			// if we have identified the critical digit, replace it with the smallest
+			// larger digit to its right
+			if (larger)
+			{
+				permutation[criticalIndex] = lowestDigit(larger);
+				available &= ~(1u << permutation[criticalIndex]);
+				break;
+			}
+		}
+
+		// The permutation is in descending order after the fixed digits, or a fixed
+		// digit failed, so there is nothing left to visit
+		if (criticalIndex < fixedDigits)
+			return false;
+
+		// Put the remaining digits after the critical digit in ascending order
+		for (int i = criticalIndex + 1; i < Length; i++)
+		{
+			permutation[i] = lowestDigit(available);
+			available &= available - 1;
+		}
+		validPermutation = isValid(permutation, criticalIndex);
+		BAUER_COUNT(countRowTest(criticalIndex, validPermutation));
+	} while (validPermutation > -1);
+
+	return true;
+}
+
+/// <summary>
+/// Moves a permutation to the first permutation (in lexicographic order) that the
+/// predicate accepts, starting with the permutation itself
+/// </summary>
+/// <typeparam name="Length">The number of digits in the permutation</typeparam>
+/// <typeparam name="First">The smallest digit in the permutation</typeparam>
+/// <param name="permutation">The permutation</param>
+/// <param name="isValid">The validity predicate</param>
+/// <param name="fixedDigits">The number of leading digits that may not change</param>
+/// <returns>False if there are no valid permutations at or after the starting permutation
+/// that begin with the fixed digits</returns>
+template <int Length, int First, typename Predicate>
+inline bool seekRow(int* permutation, Predicate& isValid, int fixedDigits = 0)
+{
+	int failedIndex = isValid(permutation, 0);
+	BAUER_COUNT(countRowTest(0, failedIndex));
+	if (failedIndex == -1)
+		return true;
+	return nextRow<Length, First>(permutation, isValid, failedIndex, fixedDigits);
+}
+
+#endif
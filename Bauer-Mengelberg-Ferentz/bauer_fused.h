@@ -0,0 +1,224 @@
+/*
+* File: bauer_fused.h
+* Author: Jeff Martin
+*
+* This file contains a single search that finds the all-trichord, Babbitt
+* all-trichord and ten-trichord rows at once. Each kind of row is described
+* by a rule, and the rows are built one pc at a time. The intervals and
+* trichords of a partial row are worked out once and checked against every
+* rule that still holds for it, and a branch is only abandoned when no rule
+* holds. Every rule asks for different trichords, so a repeated trichord ends
+* the branch for all of them, and the rows of each rule are still found in
+* the same order as its own search.
+*
+* Copyright  2022 by Jeffrey Martin. All rights reserved.
+* Email: jmartin@jeffreymartincomposer.com
+* Website: https://jeffreymartincomposer.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BAUERFUSED
+#define BAUERFUSED
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "bauer_binary.h"
+#include "bauer_engine.h"
+#include "bauer_setclass.h"
+
+/// <summary>
+/// A kind of trichord row. Its imbricated trichords are all in different set classes,
+/// none of them in an excluded class.
+/// </summary>
+struct TrichordRowRule
+{
+	// true if the two trichords that wrap around from the end of the row count too
+	bool cyclic;
+
+	// a bitmask of the set classes that may not appear, with bit 0 for 3-1
+	int excluded;
+
+	// the search for this kind of row stops at the first row that begins with this prefix
+	int endPrefix[3];
+	int endLength;
+};
+
+// the rules of the three trichord generators
+const TrichordRowRule ALL_TRICHORD_RULE = { true, 0, { 0, 6 }, 2 };
+const TrichordRowRule BABBITT_TRICHORD_RULE = { false, (1 << 9) | (1 << 11), { 0, 6, 7 }, 3 };
+const TrichordRowRule TEN_TRICHORD_RULE = { false, 0, { 0, 6, 7 }, 3 };
+
+template <typename Sink>
+static void extendFusedTrichordRow(const TrichordRowRule* rules, int count, Sink* const* sinks, int* row, int* intervals, int depth, int used, int seen, int alive);
+template <typename Sink>
+void findTrichordRowsFused(const TrichordRowRule* rules, int count, Sink* const* sinks);
+void generateTrichordRowsFused(std::string allTrichordFile, std::string babbittFile, std::string tenFile);
+
+/// <summary>
+/// Generates the all-trichord, Babbitt all-trichord and ten-trichord rows with one search
+/// </summary>
+/// <param name="allTrichordFile">The destination file of the all-trichord rows, or empty to skip them</param>
+/// <param name="babbittFile">The destination file of the Babbitt all-trichord rows, or empty to skip them</param>
+/// <param name="tenFile">The destination file of the ten-trichord rows, or empty to skip them</param>
+void generateTrichordRowsFused(std::string allTrichordFile, std::string babbittFile, std::string tenFile)
+{
+	const std::string files[3] = { allTrichordFile, babbittFile, tenFile };
+	const char* names[3] = { "allTrichordRows", "allTrichordBabbittRows", "tenTrichordRows" };
+	const TrichordRowRule kinds[3] = { ALL_TRICHORD_RULE, BABBITT_TRICHORD_RULE, TEN_TRICHORD_RULE };
+	std::vector<TrichordRowRule> rules;
+	std::vector<std::unique_ptr<RowFileWriter>> writers;
+	std::vector<RowFileWriter*> sinks;
+	std::vector<const char*> sinkNames;
+	for (int i = 0; i < 3; i++)
+	{
+		if (files[i].empty())
+			continue;
+		rules.push_back(kinds[i]);
+		writers.emplace_back(new RowFileWriter(files[i], names[i], 12, 12));
+		sinks.push_back(writers.back().get());
+		sinkNames.push_back(names[i]);
+	}
+
+	std::cout << "Starting...\n";
+	BAUER_COUNT(resetSearchStats());
+	if (!rules.empty())
+		findTrichordRowsFused(rules.data(), (int)rules.size(), sinks.data());
+
+	// finish the files
+	for (size_t i = 0; i < writers.size(); i++)
+	{
+		writers[i]->close();
+		std::cout << "Found " << writers[i]->count() << " rows for " << sinkNames[i] << ".\n";
+	}
+
+#ifdef BAUER_INSTRUMENT
+	// the counters cover the whole sweep, so they go next to the first file
+	for (int i = 0; i < 3; i++)
+	{
+		if (!files[i].empty())
+		{
+			finishSearchStats(files[i] + ".stats.json");
+			break;
+		}
+	}
+#endif
+	std::cout << "Done.\n";
+}
+
+/// <summary>
+/// Finds the rows of several kinds of trichord row with one search. The rows of each
+/// kind are written to its own sink, in the same order as the search for that kind alone.
+/// </summary>
+/// <param name="rules">The kinds of row, no more than 16</param>
+/// <param name="count">The number of kinds</param>
+/// <param name="sinks">The sink for each kind</param>
+template <typename Sink>
+void findTrichordRowsFused(const TrichordRowRule* rules, int count, Sink* const* sinks)
+{
+	int row[12] = { 0 };
+	int intervals[13];
+	extendFusedTrichordRow(rules, count, sinks, row, intervals, 1, 1, 0, (1 << count) - 1);
+}
+
+/// <summary>
+/// Tries every unused pc at one position of a partial row
+/// </summary>
+/// <param name="rules">The kinds of row</param>
+/// <param name="count">The number of kinds</param>
+/// <param name="sinks">The sink for each kind</param>
+/// <param name="row">The partial row</param>
+/// <param name="intervals">The intervals of the partial row</param>
+/// <param name="depth">The position to fill</param>
+/// <param name="used">A bitmask of the pcs already in the row</param>
+/// <param name="seen">A bitmask of the set classes of the trichords so far</param>
+/// <param name="alive">A bitmask of the kinds of row the partial row can still become</param>
+template <typename Sink>
+static void extendFusedTrichordRow(const TrichordRowRule* rules, int count, Sink* const* sinks, int* row, int* intervals, int depth, int used, int seen, int alive)
+{
+	if (depth == 12)
+	{
+		// the trichords that wrap around use the interval back to the first pc
+		intervals[11] = row[0] - row[11];
+		if (intervals[11] < 0)
+			intervals[11] += 12;
+		int last = 1 << (trichordClass(intervals[10], intervals[11]) - 1);
+		int wrap = 1 << (trichordClass(intervals[11], intervals[0]) - 1);
+		bool wrapDistinct = !(seen & last) && !(seen & wrap) && last != wrap;
+		BAUER_COUNT(bool valid = false);
+		for (int i = 0; i < count; i++)
+		{
+			if (!((alive >> i) & 1))
+				continue;
+			if (rules[i].cyclic && (!wrapDistinct || (rules[i].excluded & (last | wrap))))
+				continue;
+			sinks[i]->write(row);
+			BAUER_COUNT(valid = true);
+		}
+		BAUER_COUNT(countLeaf(valid));
+		return;
+	}
+
+	int candidates = ~used & 0xfff;
+	while (candidates)
+	{
+		int pc = lowestDigit((unsigned int)candidates);
+		candidates &= candidates - 1;
+		row[depth] = pc;
+		intervals[depth - 1] = pc - row[depth - 1];
+		if (intervals[depth - 1] < 0)
+			intervals[depth - 1] += 12;
+
+		// a repeated trichord fails every rule
+		BAUER_COUNT(countNode(depth));
+		int nextSeen = seen;
+		int nextAlive = alive;
+		if (depth >= 2)
+		{
+			int bit = 1 << (trichordClass(intervals[depth - 2], intervals[depth - 1]) - 1);
+			if (seen & bit)
+			{
+				BAUER_COUNT(countPrune(depth));
+				continue;
+			}
+			nextSeen |= bit;
+			for (int i = 0; i < count; i++)
+			{
+				if (rules[i].excluded & bit)
+					nextAlive &= ~(1 << i);
+			}
+		}
+
+		// a rule's own search ends at its end prefix, and every later prefix is larger
+		for (int i = 0; i < count; i++)
+		{
+			if (depth != rules[i].endLength - 1)
+				continue;
+			int compare = 0;
+			for (int j = 0; j <= depth && compare == 0; j++)
+				compare = row[j] - rules[i].endPrefix[j];
+			if (compare >= 0)
+				nextAlive &= ~(1 << i);
+		}
+		if (nextAlive == 0)
+		{
+			BAUER_COUNT(countPrune(depth));
+			continue;
+		}
+		extendFusedTrichordRow(rules, count, sinks, row, intervals, depth + 1, used | (1 << pc), nextSeen, nextAlive);
+	}
+}
+
+#endif
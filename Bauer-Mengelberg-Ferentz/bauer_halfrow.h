@@ -0,0 +1,220 @@
+/*
+* File: bauer_halfrow.h
+* Author: Jeff Martin
+*
+* This file contains a join engine for the trichord rows. A twelve-tone row is
+* split into two six-note halves. Four of its imbricated trichords lie inside
+* each half and the rest cross the boundary between them. Every half with
+* four different allowed trichords is found once, and the halves are indexed
+* by the pcs they hold. Each first half is then joined with the second halves
+* that hold exactly the other six pcs, and only the trichords that cross the
+* boundary are looked up for each pair.
+*
+* Copyright  2022 by Jeffrey Martin. All rights reserved.
+* Email: jmartin@jeffreymartincomposer.com
+* Website: https://jeffreymartincomposer.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BAUERHALFROW
+#define BAUERHALFROW
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "bauer_setclass.h"
+
+/// <summary>
+/// Six consecutive pcs of a row, with a bitmask of the set classes of the four
+/// trichords inside them
+/// </summary>
+struct HalfRow
+{
+	uint8_t pcs[6];
+	int trichords;
+};
+
+/// <summary>
+/// Every half row with four different allowed trichords, indexed by the pcs it holds
+/// </summary>
+class HalfRowIndex
+{
+public:
+	/// <summary>
+	/// Finds every half row
+	/// </summary>
+	/// <param name="trichordTable">The trichord table</param>
+	/// <param name="excluded">A bitmask of the set classes that no trichord may have</param>
+	HalfRowIndex(const ChordClassTable<3>& trichordTable, int excluded) : trichordTable(&trichordTable), excluded(excluded), bySet(1 << 12)
+	{
+		HalfRow half;
+		extend(half, 0, 0, 0);
+	}
+
+	/// <summary>
+	/// Gets the set class of a trichord, as a bit
+	/// </summary>
+	/// <param name="a">The first pc</param>
+	/// <param name="b">The second pc</param>
+	/// <param name="c">The third pc</param>
+	/// <returns>The bit of the set class</returns>
+	int trichord(int a, int b, int c) const
+	{
+		int first = b - a;
+		if (first < 0)
+			first += 12;
+		int second = c - b;
+		if (second < 0)
+			second += 12;
+		return 1 << (trichordTable->classes[first * 12 + second] - 1);
+	}
+
+	/// <summary>
+	/// Gets the set classes that no trichord may have
+	/// </summary>
+	/// <returns>A bitmask of the set classes</returns>
+	int excludedTrichords() const
+	{
+		return excluded;
+	}
+
+	/// <summary>
+	/// Gets the half rows that begin with pc 0, in lexicographic order
+	/// </summary>
+	/// <returns>The half rows</returns>
+	const std::vector<HalfRow>& firstHalves() const
+	{
+		return beginningWithZero;
+	}
+
+	/// <summary>
+	/// Gets the half rows that hold a set of pcs, in lexicographic order
+	/// </summary>
+	/// <param name="pcs">A bitmask of the pcs</param>
+	/// <returns>The half rows</returns>
+	const std::vector<HalfRow>& holding(int pcs) const
+	{
+		return bySet[pcs];
+	}
+
+private:
+	const ChordClassTable<3>* trichordTable;
+	int excluded;
+	std::vector<std::vector<HalfRow>> bySet;
+	std::vector<HalfRow> beginningWithZero;
+
+	/// <summary>
+	/// Tries every unused pc at one position of a half row
+	/// </summary>
+	/// <param name="half">The partial half row</param>
+	/// <param name="depth">The position to fill</param>
+	/// <param name="used">A bitmask of the pcs used so far</param>
+	/// <param name="trichords">A bitmask of the set classes of the trichords so far</param>
+	void extend(HalfRow& half, int depth, int used, int trichords)
+	{
+		if (depth == 6)
+		{
+			half.trichords = trichords;
+			bySet[used].push_back(half);
+			if (half.pcs[0] == 0)
+				beginningWithZero.push_back(half);
+			return;
+		}
+		for (int pc = 0; pc < 12; pc++)
+		{
+			if (used & (1 << pc))
+				continue;
+			int added = 0;
+			if (depth >= 2)
+			{
+				added = trichord(half.pcs[depth - 2], half.pcs[depth - 1], pc);
+				if ((added & excluded) || (added & trichords))
+					continue;
+			}
+			half.pcs[depth] = (uint8_t)pc;
+			extend(half, depth + 1, used | (1 << pc), trichords | added);
+		}
+	}
+};
+
+/// <summary>
+/// Finds the rows that begin with pc 0 and lie before an end prefix, and whose imbricated
+/// trichords all have different allowed set classes. The rows are written in lexicographic order.
+/// </summary>
+/// <param name="index">The half rows</param>
+/// <param name="cyclic">True if the trichords also wrap around from the end of the row to its beginning</param>
+/// <param name="endPrefix">The first prefix that is not searched</param>
+/// <param name="endLength">The number of pcs in the end prefix, no more than 6</param>
+/// <param name="sink">The sink to write the rows to</param>
+template <typename Sink>
+void joinTrichordHalfRows(const HalfRowIndex& index, bool cyclic, const int* endPrefix, int endLength, Sink& sink)
+{
+	const std::vector<HalfRow>& firstHalves = index.firstHalves();
+	int excluded = index.excludedTrichords();
+	int row[12];
+	for (size_t i = 0; i < firstHalves.size(); i++)
+	{
+		const HalfRow& first = firstHalves[i];
+
+		// the first halves are in order, so we can stop at the first one past the end
+		int compare = 0;
+		for (int j = 0; j < endLength && compare == 0; j++)
+			compare = first.pcs[j] - endPrefix[j];
+		if (compare >= 0)
+			break;
+
+		int pcs = 0;
+		for (int j = 0; j < 6; j++)
+			pcs |= 1 << first.pcs[j];
+		const std::vector<HalfRow>& secondHalves = index.holding(~pcs & 0xFFF);
+		for (size_t j = 0; j < secondHalves.size(); j++)
+		{
+			const HalfRow& second = secondHalves[j];
+			int trichords = first.trichords;
+			if (trichords & second.trichords)
+				continue;
+			trichords |= second.trichords;
+
+			// the trichords that cross the boundary
+			int crossing[4];
+			int count = 2;
+			crossing[0] = index.trichord(first.pcs[4], first.pcs[5], second.pcs[0]);
+			crossing[1] = index.trichord(first.pcs[5], second.pcs[0], second.pcs[1]);
+			if (cyclic)
+			{
+				crossing[2] = index.trichord(second.pcs[4], second.pcs[5], first.pcs[0]);
+				crossing[3] = index.trichord(second.pcs[5], first.pcs[0], first.pcs[1]);
+				count = 4;
+			}
+			bool valid = true;
+			for (int k = 0; k < count && valid; k++)
+			{
+				if ((crossing[k] & excluded) || (crossing[k] & trichords))
+					valid = false;
+				trichords |= crossing[k];
+			}
+			if (!valid)
+				continue;
+
+			for (int k = 0; k < 6; k++)
+			{
+				row[k] = first.pcs[k];
+				row[k + 6] = second.pcs[k];
+			}
+			sink.write(row);
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,248 @@
+/*
+* File: bauer_kchord.h
+* Author: Jeff Martin
+*
+* This file contains a branch-and-bound search for twelve-tone rows whose
+* imbricated trichords, tetrachords or pentachords fall into as many
+* different set classes as possible. For tetrachords and pentachords a row
+* cannot always have every chord in a different class, so the search either
+* finds the largest number of classes any row can have, or lists the rows
+* that reach a given number. A partial row is abandoned as soon as the
+* classes it already has plus one for each chord not yet complete cannot
+* reach the goal.
+*
+* Copyright  2022 by Jeffrey Martin. All rights reserved.
+* Email: jmartin@jeffreymartincomposer.com
+* Website: https://jeffreymartincomposer.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BAUERKCHORD
+#define BAUERKCHORD
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "bauer_binary.h"
+#include "bauer_engine.h"
+#include "bauer_setclass.h"
+
+/// <summary>
+/// The state of a search over the imbricated chords of one size
+/// </summary>
+/// <typeparam name="Size">The number of pcs in each chord, from 3 to 5</typeparam>
+template <int Size>
+struct ImbricatedChordSearch
+{
+	// the number of chords in a row. A cyclic row also has the chords that wrap around.
+	bool cyclic;
+	int windows;
+
+	// the number of different classes a row must have to be kept. When looking for the
+	// largest number, it is one more than the best row found so far.
+	int goal;
+	bool maximize;
+
+	// the row, and the interval after each pc, with room to repeat the first
+	// intervals after the last for the chords that wrap around
+	int row[12];
+	int intervals[12 + Size];
+
+	ImbricatedChordSearch(bool cyclic, int goal, bool maximize) : cyclic(cyclic), windows(cyclic ? 12 : 13 - Size), goal(goal), maximize(maximize)
+	{
+		row[0] = 0;
+	}
+
+	/// <summary>
+	/// Gets the set class of the chord that begins at a pc
+	/// </summary>
+	/// <param name="start">The index of the first pc of the chord</param>
+	/// <returns>The Forte ordinal of the chord, from 1</returns>
+	int chordClass(int start) const
+	{
+		int key = 0;
+		for (int i = 0; i < Size - 1; i++)
+			key = key * 12 + intervals[start + i];
+		if (Size == 3)
+			return TRICHORD_TABLE.classes[key];
+		if (Size == 4)
+			return TETRACHORD_TABLE.classes[key];
+		return PENTACHORD_TABLE.classes[key];
+	}
+};
+
+template <int Size, typename Sink>
+static void extendImbricatedChordRow(ImbricatedChordSearch<Size>& search, int depth, int used, uint64_t seen, int distinct, Sink* sink);
+template <int Size, typename Sink>
+void findImbricatedChordRows(bool cyclic, int threshold, Sink& sink);
+template <int Size>
+int findMostDistinctImbricatedChords(bool cyclic);
+void generateImbricatedChordRows(std::string destinationFile, int size, bool cyclic, int threshold = 0);
+template <int Size>
+static void generateImbricatedChordRows(std::string destinationFile, bool cyclic, int threshold);
+
+/// <summary>
+/// Generates the twelve-tone rows beginning with 0 whose imbricated chords fall into
+/// at least a given number of set classes
+/// </summary>
+/// <param name="destinationFile">The destination file, in binary if it ends in .bin and in JSON otherwise</param>
+/// <param name="size">The number of pcs in each chord, from 3 to 5</param>
+/// <param name="cyclic">True to include the chords that wrap around from the end of the row to the beginning</param>
+/// <param name="threshold">The number of classes, or 0 for the largest number any row has</param>
+void generateImbricatedChordRows(std::string destinationFile, int size, bool cyclic, int threshold)
+{
+	if (size == 3)
+		generateImbricatedChordRows<3>(destinationFile, cyclic, threshold);
+	else if (size == 4)
+		generateImbricatedChordRows<4>(destinationFile, cyclic, threshold);
+	else if (size == 5)
+		generateImbricatedChordRows<5>(destinationFile, cyclic, threshold);
+	else
+		throw std::invalid_argument("The chord size must be 3, 4 or 5");
+}
+
+/// <summary>
+/// Generates the rows for one chord size
+/// </summary>
+/// <typeparam name="Size">The number of pcs in each chord</typeparam>
+/// <param name="destinationFile">The destination file</param>
+/// <param name="cyclic">True to include the chords that wrap around</param>
+/// <param name="threshold">The number of classes, or 0 for the largest number any row has</param>
+template <int Size>
+static void generateImbricatedChordRows(std::string destinationFile, bool cyclic, int threshold)
+{
+	const char* names[3] = { "imbricatedTrichordRows", "imbricatedTetrachordRows", "imbricatedPentachordRows" };
+	RowFileWriter writer(destinationFile, names[Size - 3], 12, 12);
+	BAUER_COUNT(resetSearchStats());
+
+	std::cout << "Starting...\n";
+	if (threshold <= 0)
+	{
+		threshold = findMostDistinctImbricatedChords<Size>(cyclic);
+		std::cout << "The most set classes in one row is " << threshold << ".\n";
+	}
+	findImbricatedChordRows<Size>(cyclic, threshold, writer);
+
+	// finish the file
+	writer.close();
+	BAUER_COUNT(finishSearchStats(destinationFile + ".stats.json"));
+
+	std::cout << "Done. Found " << writer.count() << " rows.\n";
+}
+
+/// <summary>
+/// Finds the largest number of set classes among the imbricated chords of any row
+/// </summary>
+/// <typeparam name="Size">The number of pcs in each chord, from 3 to 5</typeparam>
+/// <param name="cyclic">True to include the chords that wrap around</param>
+/// <returns>The number of set classes</returns>
+template <int Size>
+int findMostDistinctImbricatedChords(bool cyclic)
+{
+	// only a row that beats the best so far is worth finishing
+	ImbricatedChordSearch<Size> search(cyclic, 1, true);
+	extendImbricatedChordRow<Size, RowCounter>(search, 1, 1, 0, 0, nullptr);
+	return search.goal - 1;
+}
+
+/// <summary>
+/// Finds the twelve-tone rows beginning with 0 whose imbricated chords fall into at least
+/// a given number of set classes, in lexicographic order
+/// </summary>
+/// <typeparam name="Size">The number of pcs in each chord, from 3 to 5</typeparam>
+/// <param name="cyclic">True to include the chords that wrap around</param>
+/// <param name="threshold">The number of set classes</param>
+/// <param name="sink">The sink to write the rows to</param>
+template <int Size, typename Sink>
+void findImbricatedChordRows(bool cyclic, int threshold, Sink& sink)
+{
+	ImbricatedChordSearch<Size> search(cyclic, threshold, false);
+	extendImbricatedChordRow<Size, Sink>(search, 1, 1, 0, 0, &sink);
+}
+
+/// <summary>
+/// Tries every unused pc at one position of a partial row
+/// </summary>
+/// <param name="search">The search state</param>
+/// <param name="depth">The position to fill</param>
+/// <param name="used">A bitmask of the pcs already in the row</param>
+/// <param name="seen">A bitmask of the set classes of the complete chords</param>
+/// <param name="distinct">The number of set classes in seen</param>
+/// <param name="sink">The sink to write the rows to, or null when only looking for the best row</param>
+template <int Size, typename Sink>
+static void extendImbricatedChordRow(ImbricatedChordSearch<Size>& search, int depth, int used, uint64_t seen, int distinct, Sink* sink)
+{
+	if (depth == 12)
+	{
+		// finish the chords that wrap around
+		if (search.cyclic)
+		{
+			search.intervals[11] = search.row[0] - search.row[11];
+			if (search.intervals[11] < 0)
+				search.intervals[11] += 12;
+			for (int i = 0; i < Size; i++)
+				search.intervals[12 + i] = search.intervals[i];
+			for (int start = 13 - Size; start < 12; start++)
+			{
+				uint64_t bit = (uint64_t)1 << search.chordClass(start);
+				if (!(seen & bit))
+					distinct++;
+				seen |= bit;
+			}
+		}
+		BAUER_COUNT(countLeaf(distinct >= search.goal));
+		if (distinct < search.goal)
+			return;
+		if (search.maximize)
+			search.goal = distinct + 1;
+		else
+			sink->write(search.row);
+		return;
+	}
+
+	// the chords still to complete after this position can each add at most one class
+	int complete = depth + 2 - Size > 0 ? depth + 2 - Size : 0;
+	int remaining = search.windows - complete;
+
+	int candidates = ~used & 0xfff;
+	while (candidates)
+	{
+		int pc = lowestDigit((unsigned int)candidates);
+		candidates &= candidates - 1;
+		search.row[depth] = pc;
+		search.intervals[depth - 1] = pc - search.row[depth - 1];
+		if (search.intervals[depth - 1] < 0)
+			search.intervals[depth - 1] += 12;
+
+		uint64_t nextSeen = seen;
+		int nextDistinct = distinct;
+		if (depth >= Size - 1)
+		{
+			uint64_t bit = (uint64_t)1 << search.chordClass(depth + 1 - Size);
+			if (!(seen & bit))
+				nextDistinct++;
+			nextSeen |= bit;
+		}
+		BAUER_COUNT(countNode(depth));
+		if (nextDistinct + remaining < search.goal)
+		{
+			BAUER_COUNT(countPrune(depth));
+			continue;
+		}
+		extendImbricatedChordRow<Size, Sink>(search, depth + 1, used | (1 << pc), nextSeen, nextDistinct, sink);
+	}
+}
+
+#endif
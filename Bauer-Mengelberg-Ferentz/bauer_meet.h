@@ -0,0 +1,418 @@
+/*
+* File: bauer_meet.h
+* Author: Jeff Martin
+*
+* This file contains a meet-in-the-middle search for all-interval row
+* generators in even equal temperaments. Every generator runs from pc 0 to the
+* tritone, so it is split into a first half that leaves pc 0 and a second half
+* that arrives at the tritone. The second halves are found by walking backward
+* from the tritone and are indexed in a hash table by the intervals they use
+* and the pcs they reach. Each first half then looks up the one set of
+* intervals and pcs that completes it, so the two halves are searched
+* separately rather than one inside the other.
+*
+* The number of second halves still grows exponentially with the modulus, and
+* they are all held in memory. The search has been run up to modulus 18,
+* where counting takes about 46 s and 490 MB. Each step of two multiplies the
+* time by about 30 and the memory by about 15, so modulus 20 needs several
+* gigabytes and modulus 24 is out of reach. The moduli up to 32 are accepted
+* only because the key has 64 bits.
+*
+* Copyright  2022 by Jeffrey Martin. All rights reserved.
+* Email: jmartin@jeffreymartincomposer.com
+* Website: https://jeffreymartincomposer.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BAUERMEET
+#define BAUERMEET
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "bauer_binary.h"
+#include "bauer_engine.h"
+
+/// <summary>
+/// The second halves of the row generators of one modulus, grouped by the intervals
+/// they use and the pcs they reach. Within a group the halves are in lexicographic order.
+/// An index that only counts keeps the number of halves in each group and not the halves.
+/// </summary>
+class SecondHalfIndex
+{
+public:
+	/// <summary>
+	/// Finds every second half of a given length
+	/// </summary>
+	/// <param name="modulus">The number of notes in the octave</param>
+	/// <param name="length">The number of intervals in each second half</param>
+	/// <param name="counting">True to keep only the number of halves in each group</param>
+	SecondHalfIndex(int modulus, int length, bool counting = false) : modulus(modulus), width(length), counting(counting)
+	{
+		std::vector<uint64_t> keys;
+		std::vector<uint8_t> found;
+		int half[64];
+		extend(modulus / 2, length - 1, (uint64_t)1 << (modulus / 2), 0, half, keys, found);
+		if (counting)
+		{
+			countGroups(keys);
+			return;
+		}
+
+		// sort the halves by group, and then each group in lexicographic order. The halves
+		// were found in order of their last interval, not their first.
+		std::vector<std::pair<uint64_t, size_t>> order(keys.size());
+		for (size_t i = 0; i < order.size(); i++)
+			order[i] = std::make_pair(keys[i], i);
+		std::vector<uint64_t>().swap(keys);
+		std::sort(order.begin(), order.end());
+
+		// size the hash table to at most half full
+		size_t groupCount = 0;
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			if (i == 0 || order[i].first != order[i - 1].first)
+				groupCount++;
+		}
+		int bits = 1;
+		while (((size_t)1 << bits) < 2 * groupCount)
+			bits++;
+		shift = 64 - bits;
+		slotKeys.assign((size_t)1 << bits, 0);
+		slotRanges.resize((size_t)1 << bits);
+
+		intervals.resize(found.size());
+		size_t begin = 0;
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			if (i + 1 < order.size() && order[i + 1].first == order[i].first)
+				continue;
+			std::sort(order.begin() + begin, order.begin() + i + 1, [&](const std::pair<uint64_t, size_t>& a, const std::pair<uint64_t, size_t>& b)
+			{
+				return std::memcmp(&found[a.second * width], &found[b.second * width], width) < 0;
+			});
+			for (size_t j = begin; j <= i; j++)
+				std::memcpy(&intervals[j * width], &found[order[j].second * width], width);
+			size_t slot = find(order[i].first);
+			slotKeys[slot] = order[i].first;
+			slotRanges[slot] = std::make_pair(begin, i + 1);
+			begin = i + 1;
+		}
+	}
+
+	/// <summary>
+	/// Finds the second halves that complete a first half
+	/// </summary>
+	/// <param name="reached">A bitmask of the pcs the first half reaches, including the pc it ends on</param>
+	/// <param name="unused">A bitmask of the intervals the first half does not use</param>
+	/// <param name="end">The pc the first half ends on</param>
+	/// <param name="begin">The index of the first matching second half</param>
+	/// <param name="last">The index after the last matching second half</param>
+	void match(uint64_t reached, uint64_t unused, int end, size_t& begin, size_t& last) const
+	{
+		size_t slot = find(completion(reached, unused, end));
+		if (slotKeys[slot] == 0)
+			begin = last = 0;
+		else
+		{
+			begin = slotRanges[slot].first;
+			last = slotRanges[slot].second;
+		}
+	}
+
+	/// <summary>
+	/// Counts the second halves that complete a first half
+	/// </summary>
+	/// <param name="reached">A bitmask of the pcs the first half reaches, including the pc it ends on</param>
+	/// <param name="unused">A bitmask of the intervals the first half does not use</param>
+	/// <param name="end">The pc the first half ends on</param>
+	/// <returns>The number of matching second halves</returns>
+	uint64_t count(uint64_t reached, uint64_t unused, int end) const
+	{
+		size_t slot = find(completion(reached, unused, end));
+		if (slotKeys[slot] == 0)
+			return 0;
+		return counting ? slotCounts[slot] : slotRanges[slot].second - slotRanges[slot].first;
+	}
+
+	/// <summary>
+	/// Gets the intervals of one second half
+	/// </summary>
+	/// <param name="i">The index of the second half</param>
+	/// <returns>The intervals, in order</returns>
+	const uint8_t* operator[](size_t i) const
+	{
+		return &intervals[i * width];
+	}
+
+	/// <summary>
+	/// Gets the number of second halves
+	/// </summary>
+	/// <returns>The number of second halves</returns>
+	size_t size() const
+	{
+		return width == 0 ? 0 : intervals.size() / width;
+	}
+
+private:
+	int modulus;
+	int width;
+	bool counting;
+	std::vector<uint8_t> intervals;
+
+	// an open-addressing hash table from each group to its range of halves, or to its
+	// number of halves if only counting. A key always has the tritone bit set, so 0
+	// marks an empty slot.
+	std::vector<uint64_t> slotKeys;
+	std::vector<std::pair<size_t, size_t>> slotRanges;
+	std::vector<uint32_t> slotCounts;
+	int shift;
+
+	/// <summary>
+	/// Finds the group of the second halves that complete a first half
+	/// </summary>
+	/// <param name="reached">A bitmask of the pcs the first half reaches, including the pc it ends on</param>
+	/// <param name="unused">A bitmask of the intervals the first half does not use</param>
+	/// <param name="end">The pc the first half ends on</param>
+	/// <returns>The group</returns>
+	uint64_t completion(uint64_t reached, uint64_t unused, int end) const
+	{
+		// the second half reaches every other pc, and starts where the first half ends
+		uint64_t all = ((uint64_t)1 << modulus) - 1;
+		uint64_t needed = (~reached & all) | ((uint64_t)1 << end);
+		return unused << 32 | needed;
+	}
+
+	/// <summary>
+	/// Builds the hash table from each group to its number of second halves
+	/// </summary>
+	/// <param name="keys">The groups of the second halves, one for each half. They are sorted and then released.</param>
+	void countGroups(std::vector<uint64_t>& keys)
+	{
+		std::sort(keys.begin(), keys.end());
+		size_t groupCount = 0;
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			if (i == 0 || keys[i] != keys[i - 1])
+				groupCount++;
+		}
+
+		// size the hash table to at most half full
+		int bits = 1;
+		while (((size_t)1 << bits) < 2 * groupCount)
+			bits++;
+		shift = 64 - bits;
+		slotKeys.assign((size_t)1 << bits, 0);
+		slotCounts.assign((size_t)1 << bits, 0);
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			size_t slot = find(keys[i]);
+			if (slotCounts[slot] == UINT32_MAX)
+				throw std::overflow_error("Too many second halves share the same intervals and pcs to count");
+			slotKeys[slot] = keys[i];
+			slotCounts[slot]++;
+		}
+		std::vector<uint64_t>().swap(keys);
+	}
+
+	/// <summary>
+	/// Finds the slot of a group, or the empty slot where it would go
+	/// </summary>
+	/// <param name="key">The group</param>
+	/// <returns>The slot</returns>
+	size_t find(uint64_t key) const
+	{
+		size_t mask = slotKeys.size() - 1;
+		size_t slot = (size_t)((key * 0x9E3779B97F4A7C15ull) >> shift);
+		while (slotKeys[slot] != 0 && slotKeys[slot] != key)
+			slot = (slot + 1) & mask;
+		return slot;
+	}
+
+	/// <summary>
+	/// Tries every unused interval at one position of a second half, working backward
+	/// from the tritone
+	/// </summary>
+	/// <param name="pc">The pc after the position</param>
+	/// <param name="position">The position to fill</param>
+	/// <param name="reached">A bitmask of the pcs reached so far</param>
+	/// <param name="used">A bitmask of the intervals used so far</param>
+	/// <param name="half">The partial second half</param>
+	/// <param name="keys">The groups of the second halves found</param>
+	/// <param name="found">The intervals of the second halves found, stored one after another, unless only counting</param>
+	void extend(int pc, int position, uint64_t reached, uint64_t used, int* half, std::vector<uint64_t>& keys, std::vector<uint8_t>& found)
+	{
+		if (position < 0)
+		{
+			keys.push_back(used << 32 | reached);
+			if (counting)
+				return;
+			for (int i = 0; i < width; i++)
+				found.push_back((uint8_t)half[i]);
+			return;
+		}
+
+		// the intervals run from 1 to modulus - 1, and pc 0 belongs to the first half
+		uint64_t all = ((uint64_t)1 << modulus) - 2;
+		uint64_t candidates = ~used & all;
+		while (candidates)
+		{
+			int interval = lowestDigitWide(candidates);
+			candidates &= candidates - 1;
+			int previous = pc - interval;
+			if (previous < 0)
+				previous += modulus;
+			if (previous == 0 || ((reached >> previous) & 1))
+				continue;
+			half[position] = interval;
+			extend(previous, position - 1, reached | ((uint64_t)1 << previous), used | ((uint64_t)1 << interval), half, keys, found);
+		}
+	}
+};
+
+uint64_t countIntervalRowGeneratorsMeetInTheMiddle(int modulus);
+template <typename Sink>
+static uint64_t extendFirstHalf(const SecondHalfIndex& index, int modulus, int length, int* permutation, int depth, int sum, uint64_t reached, uint64_t unused, Sink* sink);
+template <typename Sink>
+void findIntervalRowGeneratorsMeetInTheMiddle(int modulus, Sink& sink);
+void generateIntervalRowGeneratorsMeetInTheMiddle(std::string destinationFile, int modulus);
+static int secondHalfLength(int modulus);
+
+/// <summary>
+/// Generates the all-interval rows of an even equal temperament with the meet-in-the-middle search
+/// </summary>
+/// <param name="destinationFile">The destination file, in binary if it ends in .bin and in JSON otherwise</param>
+/// <param name="modulus">The number of notes in the octave, an even number from 4 to 32</param>
+void generateIntervalRowGeneratorsMeetInTheMiddle(std::string destinationFile, int modulus)
+{
+	RowFileWriter writer(destinationFile, modulus == 12 ? "elevenIntervalRowGenerators" : "intervalRowGenerators", modulus, modulus - 1);
+
+	std::cout << "Starting...\n";
+	findIntervalRowGeneratorsMeetInTheMiddle(modulus, writer);
+
+	// finish the file
+	writer.close();
+
+	std::cout << "Done. Found " << writer.count() << " row generators.\n";
+}
+
+/// <summary>
+/// Finds the all-interval row generators of an even equal temperament that begin with
+/// an interval smaller than half the octave, in the same order as findIntervalRowGenerators
+/// </summary>
+/// <param name="modulus">The number of notes in the octave, an even number from 4 to 32</param>
+/// <param name="sink">The sink to write the generators to</param>
+template <typename Sink>
+void findIntervalRowGeneratorsMeetInTheMiddle(int modulus, Sink& sink)
+{
+	// the intervals and the pcs of a half share one 64-bit key
+	if (modulus < 4 || modulus > 32 || modulus % 2 != 0)
+		throw std::invalid_argument("The modulus must be an even number from 4 to 32");
+
+	int length = secondHalfLength(modulus);
+	SecondHalfIndex index(modulus, length);
+	uint64_t unused = (((uint64_t)1 << modulus) - 1) & ~(uint64_t)1;
+	int permutation[63];
+	extendFirstHalf(index, modulus, modulus - 1 - length, permutation, 0, 0, 1, unused, &sink);
+}
+
+/// <summary>
+/// Counts the all-interval row generators of an even equal temperament that begin with
+/// an interval smaller than half the octave, without writing them
+/// </summary>
+/// <param name="modulus">The number of notes in the octave, an even number from 4 to 32</param>
+/// <returns>The number of row generators</returns>
+uint64_t countIntervalRowGeneratorsMeetInTheMiddle(int modulus)
+{
+	if (modulus < 4 || modulus > 32 || modulus % 2 != 0)
+		throw std::invalid_argument("The modulus must be an even number from 4 to 32");
+
+	int length = secondHalfLength(modulus);
+	SecondHalfIndex index(modulus, length, true);
+	uint64_t unused = (((uint64_t)1 << modulus) - 1) & ~(uint64_t)1;
+	int permutation[63];
+	RowCounter* none = nullptr;
+	return extendFirstHalf(index, modulus, modulus - 1 - length, permutation, 0, 0, 1, unused, none);
+}
+
+/// <summary>
+/// Chooses how many intervals go into the second half. The second halves are kept in
+/// memory, so they are made a little shorter than the first halves, which are not.
+/// </summary>
+/// <param name="modulus">The number of notes in the octave</param>
+/// <returns>The number of intervals in each second half</returns>
+static int secondHalfLength(int modulus)
+{
+	return (modulus - 1) / 2 - (modulus >= 14 ? 1 : 0);
+}
+
+/// <summary>
+/// Tries every unused interval at one position of a first half, and joins each complete
+/// first half with the second halves that complete it
+/// </summary>
+/// <param name="index">The second halves</param>
+/// <param name="modulus">The number of notes in the octave</param>
+/// <param name="length">The number of intervals in each first half</param>
+/// <param name="permutation">The partial row generator</param>
+/// <param name="depth">The position to fill</param>
+/// <param name="sum">The pc reached by the intervals before the position</param>
+/// <param name="reached">A bitmask of the pcs reached so far</param>
+/// <param name="unused">A bitmask of the intervals not used yet</param>
+/// <param name="sink">The sink to write the generators to, or null to only count them</param>
+/// <returns>The number of generators that begin with the partial generator</returns>
+template <typename Sink>
+static uint64_t extendFirstHalf(const SecondHalfIndex& index, int modulus, int length, int* permutation, int depth, int sum, uint64_t reached, uint64_t unused, Sink* sink)
+{
+	if (depth == length)
+	{
+		if (!sink)
+			return index.count(reached, unused, sum);
+		size_t begin, last;
+		index.match(reached, unused, sum, begin, last);
+		for (size_t i = begin; i < last; i++)
+		{
+			const uint8_t* half = index[i];
+			for (int j = length; j < modulus - 1; j++)
+				permutation[j] = half[j - length];
+			sink->write(permutation);
+		}
+		return last - begin;
+	}
+
+	// the tritone belongs to the second half, and generators beginning with a
+	// tritone or more are inversions of ones we have already found
+	int tritone = modulus / 2;
+	uint64_t candidates = depth == 0 ? unused & (((uint64_t)1 << tritone) - 1) : unused;
+	uint64_t total = 0;
+	while (candidates)
+	{
+		int interval = lowestDigitWide(candidates);
+		candidates &= candidates - 1;
+		int pc = sum + interval;
+		if (pc >= modulus)
+			pc -= modulus;
+		if (((reached >> pc) & 1) || pc == tritone)
+			continue;
+		permutation[depth] = interval;
+		total += extendFirstHalf(index, modulus, length, permutation, depth + 1, pc, reached | ((uint64_t)1 << pc), unused & ~((uint64_t)1 << interval), sink);
+	}
+	return total;
+}
+
+#endif
@@ -22,16 +22,80 @@
 * along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <string>
+#include <vector>
 #include "bauer_algorithm.h"
+#include "bauer_constraint.h"
+#include "bauer_merge.h"
+#include "bauer_perf.h"
+#include "bauer_shard.h"
 #include "bauer_trichord.h"
 #include "bauer_trichord_ten.h"
 #include "bauer_trichord_babbitt.h"
 
-int main()
+int main(int argc, char* argv[])
 {
-	generateAllIntervalRowGenerators("C:\\all_interval.json");
-	generateAllTrichordRows("C:\\all_trichord.json");
-	generateBabbittAllTrichordRows("C:\\all_trichord_babbitt.json");
-	generateTenTrichordRows("C:\\ten_trichord.json");
+	// --resume carries on each search from its last checkpoint, --shard i/n runs shard i
+	// of n of each search, and --merge n merges the n shards of each search. Instead of
+	// the searches, --profile dir profiles each serial search phase by phase, writing
+	// its scratch files to dir, and --constraints searches for the rows a description describes.
+	bool resume = false;
+	SearchShard shard = WHOLE_SEARCH;
+	int mergeCount = 0;
+	bool profile = false;
+	std::string profileDirectory;
+	std::string constraints;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--resume")
+			resume = true;
+		else if (argument == "--shard" && i + 1 < argc)
+			shard = parseShard(argv[++i]);
+		else if (argument == "--merge" && i + 1 < argc)
+			mergeCount = std::stoi(argv[++i]);
+		else if (argument == "--profile" && i + 1 < argc)
+		{
+			profile = true;
+			profileDirectory = argv[++i];
+		}
+		else if (argument == "--constraints" && i + 1 < argc)
+			constraints = argv[++i];
+	}
+
+	if (profile)
+	{
+		profileGenerators(profileDirectory);
+		return 0;
+	}
+
+	// search with every hardware thread
+	const unsigned int threads = 0;
+	if (!constraints.empty())
+	{
+		generateConstrainedRows("C:\\constrained_rows.json", "constrainedRows", constraints, threads);
+		return 0;
+	}
+
+	const std::string files[4] = { "C:\\all_interval.json", "C:\\all_trichord.json", "C:\\all_trichord_babbitt.json", "C:\\ten_trichord.json" };
+	if (mergeCount > 0)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			std::vector<std::string> shardFiles;
+			for (int j = 0; j < mergeCount; j++)
+			{
+				SearchShard part = { j, mergeCount };
+				shardFiles.push_back(shardFileName(files[i], part));
+			}
+			mergeRowFiles(shardFiles, files[i]);
+		}
+		return 0;
+	}
+
+	generateAllIntervalRowGenerators(shardFileName(files[0], shard), threads, resume, shard);
+	generateAllTrichordRows(shardFileName(files[1], shard), threads, resume, shard);
+	generateBabbittAllTrichordRows(shardFileName(files[2], shard), threads, resume, shard);
+	generateTenTrichordRows(shardFileName(files[3], shard), threads, resume, shard);
 	return 0;
 }
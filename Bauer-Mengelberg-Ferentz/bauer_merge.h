@@ -0,0 +1,250 @@
+/*
+* File: bauer_merge.h
+* Author: Jeff Martin
+*
+* This file contains a merge of row files, for putting the shards of a search
+* back together. Each shard file is already in lexicographic order, so one
+* pass that always takes the smallest next row of any file writes every row
+* in order. The files are read a row at a time, JSON or binary, so the merge
+* runs in memory that depends only on the number of files.
+*
+* Copyright  2022 by Jeffrey Martin. All rights reserved.
+* Email: jmartin@jeffreymartincomposer.com
+* Website: https://jeffreymartincomposer.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BAUERMERGE
+#define BAUERMERGE
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "bauer_binary.h"
+
+void mergeRowFiles(const std::vector<std::string>& inputPaths, std::string outputPath);
+
+/// <summary>
+/// Reads the rows of a JSON or binary row file in order, one at a time
+/// </summary>
+class RowFileReader
+{
+public:
+	/// <summary>
+	/// Opens the file and reads what it holds. A JSON file does not record its modulus, so
+	/// its rows are read through once to work it out the way convertJsonToBinary does.
+	/// </summary>
+	/// <param name="path">The file to read, in binary if it ends in .bin and in JSON otherwise</param>
+	RowFileReader(std::string path) : path(path), next(0), ended(false)
+	{
+		if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".bin") == 0)
+		{
+			binary.reset(new BinaryRowFile(path));
+			rowName = binary->name();
+			rowLength = binary->length();
+			rowModulus = binary->modulus();
+			return;
+		}
+
+		json.open(path);
+		if (!json.is_open())
+			throw std::runtime_error("Could not open " + path);
+
+		// the name of the generator is the only key in the file, and the rows follow it
+		std::string skipped;
+		std::getline(json, skipped, '"');
+		std::getline(json, rowName, '"');
+		std::getline(json, skipped, '[');
+		if (!json)
+			throw std::runtime_error(path + " is not a row file");
+
+		// read every row for the modulus, then go back to the first row
+		std::streampos rowsStart = json.tellg();
+		bool hasZero = false;
+		int largest = 0;
+		rowLength = 0;
+		while (readJsonRow(values))
+		{
+			if (rowLength == 0)
+				rowLength = (int)values.size();
+			else if ((int)values.size() != rowLength)
+				throw std::runtime_error(path + " has rows of different lengths");
+			hasZero = hasZero || std::find(values.begin(), values.end(), 0) != values.end();
+			largest = std::max(largest, *std::max_element(values.begin(), values.end()));
+		}
+		rowModulus = jsonRowModulus(rowLength, hasZero, largest);
+		json.clear();
+		json.seekg(rowsStart);
+		ended = rowLength == 0;
+	}
+
+	/// <summary>
+	/// Reads the next row
+	/// </summary>
+	/// <param name="row">An array with room for the row</param>
+	/// <returns>False if there are no more rows</returns>
+	bool read(int* row)
+	{
+		if (binary)
+		{
+			if (next == binary->size())
+				return false;
+			(*binary)[next++].copyTo(row);
+			return true;
+		}
+		if (ended)
+			return false;
+		if (!readJsonRow(values))
+		{
+			ended = true;
+			return false;
+		}
+		if ((int)values.size() != rowLength)
+			throw std::runtime_error(path + " has rows of different lengths");
+		std::copy(values.begin(), values.end(), row);
+		return true;
+	}
+
+	/// <summary>
+	/// Gets the name of the generator that wrote the file
+	/// </summary>
+	/// <returns>The name of the generator</returns>
+	std::string name() const
+	{
+		return rowName;
+	}
+
+	/// <summary>
+	/// Gets the number of pcs or intervals in each row, or 0 if a JSON file has no rows
+	/// </summary>
+	/// <returns>The length of each row</returns>
+	int length() const
+	{
+		return rowLength;
+	}
+
+	/// <summary>
+	/// Gets the modulus of the pcs or intervals
+	/// </summary>
+	/// <returns>The modulus</returns>
+	int modulus() const
+	{
+		return rowModulus;
+	}
+
+private:
+	std::string path;
+	std::unique_ptr<BinaryRowFile> binary;
+	size_t next;
+	std::ifstream json;
+	std::vector<int> values;
+	bool ended;
+	std::string rowName;
+	int rowLength;
+	int rowModulus;
+
+	/// <summary>
+	/// Reads the next row of a JSON file
+	/// </summary>
+	/// <param name="row">Set to the values of the row</param>
+	/// <returns>False at the end of the array of rows</returns>
+	bool readJsonRow(std::vector<int>& row)
+	{
+		row.clear();
+		char c = 0;
+		while (json.get(c) && c != '[')
+		{
+			if (c == ']')
+				return false;
+		}
+		if (!json)
+			throw std::runtime_error(path + " is truncated");
+		do
+		{
+			int value;
+			if (!(json >> value >> c) || (c != ',' && c != ']'))
+				throw std::runtime_error(path + " is not a row file");
+			row.push_back(value);
+		} while (c == ',');
+		return true;
+	}
+};
+
+/// <summary>
+/// Merges row files that are each in lexicographic order into one file in lexicographic order
+/// </summary>
+/// <param name="inputPaths">The files to merge, JSON or binary, all from the same generator</param>
+/// <param name="outputPath">The file to write, in binary if it ends in .bin and in JSON otherwise</param>
+void mergeRowFiles(const std::vector<std::string>& inputPaths, std::string outputPath)
+{
+	if (inputPaths.empty())
+		throw std::invalid_argument("There are no files to merge");
+
+	// every file must hold the same kind of row, though an empty JSON file has no length
+	std::vector<std::unique_ptr<RowFileReader>> readers;
+	int length = 0;
+	int modulus = 0;
+	for (size_t i = 0; i < inputPaths.size(); i++)
+	{
+		readers.emplace_back(new RowFileReader(inputPaths[i]));
+		const RowFileReader& reader = *readers.back();
+		if (reader.name() != readers[0]->name())
+			throw std::runtime_error(inputPaths[i] + " is from a different generator than " + inputPaths[0]);
+		if (reader.length() > 0 && length > 0 && reader.length() != length)
+			throw std::runtime_error(inputPaths[i] + " has rows of a different length than the other files");
+		length = std::max(length, reader.length());
+		modulus = std::max(modulus, reader.modulus());
+	}
+
+	// a heap of the files by their next row, with the earlier file first among equal rows
+	std::vector<std::vector<int>> heads(readers.size(), std::vector<int>(length));
+	auto comesAfter = [&](size_t a, size_t b)
+	{
+		if (heads[a] != heads[b])
+			return heads[b] < heads[a];
+		return b < a;
+	};
+	std::priority_queue<size_t, std::vector<size_t>, decltype(comesAfter)> queue(comesAfter);
+	for (size_t i = 0; i < readers.size(); i++)
+	{
+		if (readers[i]->read(heads[i].data()))
+			queue.push(i);
+	}
+
+	RowFileWriter writer(outputPath, readers[0]->name(), modulus, length);
+	std::vector<int> previous;
+	while (!queue.empty())
+	{
+		size_t i = queue.top();
+		queue.pop();
+		writer.write(heads[i].data());
+		previous = heads[i];
+		if (readers[i]->read(heads[i].data()))
+		{
+			if (heads[i] < previous)
+				throw std::runtime_error(inputPaths[i] + " is not in lexicographic order");
+			queue.push(i);
+		}
+	}
+	writer.close();
+
+	std::cout << "Merged " << writer.count() << " rows into " << outputPath << ".\n";
+}
+
+#endif
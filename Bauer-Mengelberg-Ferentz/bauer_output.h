@@ -0,0 +1,253 @@
+/*
+* File: bauer_output.h
+* Author: Jeff Martin
+*
+* This file contains the result sinks that the searches write rows to. A sink
+* is any type with a write(const int* row) member. JsonRowWriter streams each
+* row to a JSON file as soon as it is found, so a search runs in constant
+* memory and the first results reach the disk right away. RowCounter only
+* counts the rows, for when the number of rows is all that is needed. A
+* file writer can also report how much of its file is complete, and carry on
+* from that point after the program is stopped, so an interrupted search can
+* be resumed.
+*
+* Copyright  2022 by Jeffrey Martin. All rights reserved.
+* Email: jmartin@jeffreymartincomposer.com
+* Website: https://jeffreymartincomposer.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BAUEROUTPUT
+#define BAUEROUTPUT
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <share.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#endif
+
+/// <summary>
+/// How much of a row file is complete: the rows written, and the bytes they end at
+/// </summary>
+struct RowFilePosition
+{
+	uint64_t rows;
+	uint64_t bytes;
+};
+
+void truncateFile(std::string path, uint64_t length);
+
+/// <summary>
+/// Counts rows without keeping or writing them
+/// </summary>
+class RowCounter
+{
+public:
+	RowCounter() : rows(0) {}
+
+	/// <summary>
+	/// Counts a row
+	/// </summary>
+	template <typename Row>
+	void write(const Row&)
+	{
+		rows++;
+	}
+
+	/// <summary>
+	/// Gets the number of rows counted so far
+	/// </summary>
+	/// <returns>The number of rows</returns>
+	size_t count() const
+	{
+		return rows;
+	}
+
+private:
+	size_t rows;
+};
+
+/// <summary>
+/// Writes rows to a JSON file as they are found. The layout is the same as the
+/// write*ToFile functions: one object holding one named array of rows. Rows are
+/// formatted by hand into a large buffer, which is written with a few large writes.
+/// </summary>
+class JsonRowWriter
+{
+public:
+	/// <summary>
+	/// Opens the file and writes the start of the array
+	/// </summary>
+	/// <param name="path">The file to write to</param>
+	/// <param name="name">The name of the array of rows</param>
+	/// <param name="length">The number of pcs or intervals in each row</param>
+	/// <param name="resumeAt">Where to carry on an unfinished file, or zero to start a new one</param>
+	JsonRowWriter(std::string path, std::string name, int length, RowFilePosition resumeAt = RowFilePosition()) : buffer(1 << 20), used(0), length(length), rows((size_t)resumeAt.rows)
+	{
+		if (resumeAt.bytes > 0)
+		{
+			// drop anything written after that point
+			truncateFile(path, resumeAt.bytes);
+			file.open(path, std::ios::in | std::ios::out);
+			file.seekp(0, std::ios::end);
+			return;
+		}
+		file.open(path);
+		std::string start = "{\n    \"" + name + "\": [\n";
+		file.write(start.data(), start.size());
+	}
+
+	~JsonRowWriter()
+	{
+		close();
+	}
+
+	/// <summary>
+	/// Writes a row to the file
+	/// </summary>
+	/// <param name="row">The row, as an array or a view of pcs or intervals</param>
+	template <typename Row>
+	void write(const Row& row)
+	{
+		// each value takes at most 11 characters plus a separator
+		if (used + 16 + (size_t)length * 13 > buffer.size())
+			flush();
+		char* out = buffer.data() + used;
+		if (rows > 0)
+		{
+			*out++ = ',';
+			*out++ = '\n';
+		}
+		for (int j = 0; j < 8; j++)
+			*out++ = ' ';
+		*out++ = '[';
+		for (int j = 0; j < length; j++)
+		{
+			if (j > 0)
+			{
+				*out++ = ',';
+				*out++ = ' ';
+			}
+			out = formatNumber(out, row[j]);
+		}
+		*out++ = ']';
+		used = out - buffer.data();
+		rows++;
+	}
+
+	/// <summary>
+	/// Writes the end of the array and closes the file
+	/// </summary>
+	void close()
+	{
+		if (!file.is_open())
+			return;
+		flush();
+		if (rows > 0)
+			file.write("\n", 1);
+		file.write("    ]\n}\n", 8);
+		file.close();
+	}
+
+	/// <summary>
+	/// Writes the buffered rows to the file
+	/// </summary>
+	/// <returns>How much of the file is complete</returns>
+	RowFilePosition sync()
+	{
+		flush();
+		file.flush();
+		RowFilePosition position = { rows, (uint64_t)file.tellp() };
+		return position;
+	}
+
+	/// <summary>
+	/// Gets the number of rows written so far
+	/// </summary>
+	/// <returns>The number of rows</returns>
+	size_t count() const
+	{
+		return rows;
+	}
+
+private:
+	std::vector<char> buffer;
+	size_t used;
+	std::ofstream file;
+	int length;
+	size_t rows;
+
+	void flush()
+	{
+		file.write(buffer.data(), used);
+		used = 0;
+	}
+
+	/// <summary>
+	/// Writes the decimal text of a number. Pcs and intervals take one or two digits,
+	/// so those are handled without a loop.
+	/// </summary>
+	/// <param name="out">Where to write the text</param>
+	/// <param name="value">The number</param>
+	/// <returns>The position after the text</returns>
+	static char* formatNumber(char* out, int value)
+	{
+		if (value >= 0 && value < 10)
+			*out++ = (char)('0' + value);
+		else if (value >= 10 && value < 100)
+		{
+			*out++ = (char)('0' + value / 10);
+			*out++ = (char)('0' + value % 10);
+		}
+		else
+		{
+			std::string text = std::to_string(value);
+			for (size_t i = 0; i < text.size(); i++)
+				*out++ = text[i];
+		}
+		return out;
+	}
+};
+
+/// <summary>
+/// Cuts a file down to a length, dropping everything after it
+/// </summary>
+/// <param name="path">The file</param>
+/// <param name="length">The number of bytes to keep</param>
+void truncateFile(std::string path, uint64_t length)
+{
+#ifdef _WIN32
+	int descriptor;
+	bool truncated = _sopen_s(&descriptor, path.c_str(), _O_RDWR | _O_BINARY, _SH_DENYNO, _S_IREAD | _S_IWRITE) == 0;
+	if (truncated)
+	{
+		truncated = _chsize_s(descriptor, (__int64)length) == 0;
+		_close(descriptor);
+	}
+#else
+	bool truncated = truncate(path.c_str(), (off_t)length) == 0;
+#endif
+	if (!truncated)
+		throw std::runtime_error("Could not truncate " + path);
+}
+
+#endif
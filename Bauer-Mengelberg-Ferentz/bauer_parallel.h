@@ -0,0 +1,339 @@
+/*
+* File: bauer_parallel.h
+* Author: Jeff Martin
+*
+* This file contains a multi-threaded driver for the skip-ahead enumerator.
+* The permutation space is split into disjoint tasks, one per prefix of the
+* first few digits. Each worker owns a range of tasks and steals half of the
+* remaining range of a busy worker when it runs out. Results are written out
+* in task order, which is the same lexicographic order the serial search uses.
+*
+* Copyright  2022 by Jeffrey Martin. All rights reserved.
+* Email: jmartin@jeffreymartincomposer.com
+* Website: https://jeffreymartincomposer.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BAUERPARALLEL
+#define BAUERPARALLEL
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "bauer_arena.h"
+#include "bauer_checkpoint.h"
+#include "bauer_engine.h"
+
+/// <summary>
+/// A contiguous range of prefix tasks owned by one worker
+/// </summary>
+struct PrefixTaskQueue
+{
+	std::mutex lock;
+	int begin = 0;
+	int end = 0;
+};
+
+/// <summary>
+/// Fills in a permutation with a prefix followed by the remaining digits in ascending order,
+/// which is the first permutation that begins with the prefix
+/// </summary>
+/// <typeparam name="Length">The number of digits in the permutation</typeparam>
+/// <typeparam name="First">The smallest digit in the permutation</typeparam>
+/// <param name="prefix">The prefix</param>
+/// <param name="depth">The number of digits in the prefix</param>
+/// <param name="permutation">The permutation to fill in</param>
+template <int Length, int First>
+void completePrefix(const int* prefix, int depth, int* permutation)
+{
+	bool used[First + Length] = { false };
+	for (int j = 0; j < depth; j++)
+	{
+		permutation[j] = prefix[j];
+		used[prefix[j]] = true;
+	}
+	for (int j = depth, digit = First; j < Length; digit++)
+	{
+		if (!used[digit])
+			permutation[j++] = digit;
+	}
+}
+
+/// <summary>
+/// Lists every prefix of distinct digits that lies before an end prefix, in lexicographic order
+/// </summary>
+/// <typeparam name="Length">The number of digits in the permutation</typeparam>
+/// <typeparam name="First">The smallest digit in the permutation</typeparam>
+/// <param name="depth">The number of digits in each prefix</param>
+/// <param name="endPrefix">The first prefix that is not searched</param>
+/// <param name="endLength">The number of digits in the end prefix (no more than depth)</param>
+/// <param name="start">A permutation whose prefix is the first one listed, or null to list from the beginning</param>
+/// <returns>The prefixes, stored one after another</returns>
+template <int Length, int First>
+std::vector<int> listPrefixes(int depth, const int* endPrefix, int endLength, const int* start = nullptr)
+{
+	std::vector<int> prefixes;
+	int prefix[Length];
+	int next[Length];
+	bool used[First + Length] = { false };
+	int position = 0;
+	next[0] = First;
+
+	// depth-first walk over the prefixes in lexicographic order
+	while (position >= 0)
+	{
+		if (next[position] >= First + Length)
+		{
+			position--;
+			if (position >= 0)
+				used[prefix[position]] = false;
+			continue;
+		}
+		int digit = next[position]++;
+		if (used[digit])
+			continue;
+		prefix[position] = digit;
+
+		// stop once we reach the end prefix, since everything after it is larger
+		if (position == endLength - 1)
+		{
+			int compare = 0;
+			for (int i = 0; i < endLength && compare == 0; i++)
+				compare = prefix[i] - endPrefix[i];
+			if (compare >= 0)
+				break;
+		}
+
+		if (position == depth - 1)
+		{
+			int compare = 0;
+			for (int i = 0; start != nullptr && i < depth && compare == 0; i++)
+				compare = prefix[i] - start[i];
+			if (compare >= 0)
+				prefixes.insert(prefixes.end(), prefix, prefix + depth);
+		}
+		else
+		{
+			used[digit] = true;
+			position++;
+			next[position] = First;
+		}
+	}
+	return prefixes;
+}
+
+/// <summary>
+/// Takes the next task for a worker, stealing from another worker if its own range is empty
+/// </summary>
+/// <param name="queues">The task ranges of all workers</param>
+/// <param name="worker">The index of the worker</param>
+/// <param name="task">The task that was taken</param>
+/// <returns>False if there are no tasks left</returns>
+static bool takePrefixTask(std::vector<std::unique_ptr<PrefixTaskQueue>>& queues, int worker, int& task)
+{
+	{
+		std::lock_guard<std::mutex> guard(queues[worker]->lock);
+		if (queues[worker]->begin < queues[worker]->end)
+		{
+			task = queues[worker]->begin++;
+			return true;
+		}
+	}
+
+	// steal the back half of the largest remaining range
+	while (true)
+	{
+		int victim = -1;
+		int remaining = 0;
+		for (int i = 0; i < (int)queues.size(); i++)
+		{
+			std::lock_guard<std::mutex> guard(queues[i]->lock);
+			if (queues[i]->end - queues[i]->begin > remaining)
+			{
+				remaining = queues[i]->end - queues[i]->begin;
+				victim = i;
+			}
+		}
+		if (victim == -1)
+			return false;
+
+		int begin, end;
+		{
+			std::lock_guard<std::mutex> guard(queues[victim]->lock);
+			remaining = queues[victim]->end - queues[victim]->begin;
+			if (remaining == 0)
+				continue;
+			end = queues[victim]->end;
+			begin = end - (remaining + 1) / 2;
+			queues[victim]->end = begin;
+		}
+
+		std::lock_guard<std::mutex> guard(queues[worker]->lock);
+		task = begin;
+		queues[worker]->begin = begin + 1;
+		queues[worker]->end = end;
+		return true;
+	}
+}
+
+/// <summary>
+/// Finds every valid permutation that lies before an end prefix, using several threads.
+/// The permutations are written to the sink in lexicographic order. As soon as every task
+/// before a finished task is finished too, its permutations are written and released.
+/// A checkpoint saved then starts at the first task that is not written yet, so a resumed
+/// search repeats only the tasks that were running or waiting on an earlier one.
+/// </summary>
+/// <typeparam name="Length">The number of digits in the permutation</typeparam>
+/// <typeparam name="First">The smallest digit in the permutation</typeparam>
+/// <param name="isValid">The validity predicate. Each worker gets its own copy.</param>
+/// <param name="endPrefix">The first prefix that is not searched</param>
+/// <param name="endLength">The number of digits in the end prefix</param>
+/// <param name="threads">The number of threads, or 0 to use every hardware thread</param>
+/// <param name="sink">The sink to write the permutations to</param>
+/// <param name="start">The first permutation to search, or null to start from the beginning</param>
+/// <param name="checkpoint">The checkpoints of the search, for a sink that is their writer, or null for none</param>
+template <int Length, int First, typename Predicate, typename Sink>
+void searchParallel(const Predicate& isValid, const int* endPrefix, int endLength, unsigned int threads, Sink& sink, const int* start = nullptr, SearchCheckpoint* checkpoint = nullptr)
+{
+	if (threads == 0)
+		threads = std::thread::hardware_concurrency();
+	if (threads == 0)
+		threads = 1;
+
+	// use enough prefix digits to give each thread plenty of tasks to balance
+	int depth = endLength;
+	std::vector<int> prefixes = listPrefixes<Length, First>(depth, endPrefix, endLength, start);
+	while (prefixes.size() / depth < (size_t)16 * threads && depth < Length - 2)
+	{
+		depth++;
+		prefixes = listPrefixes<Length, First>(depth, endPrefix, endLength, start);
+	}
+	int taskCount = (int)(prefixes.size() / depth);
+
+	// a task starts with its prefix followed by the remaining digits in ascending order,
+	// unless the search starts partway through it
+	auto taskStart = [&](int task, int* permutation)
+	{
+		const int* prefix = &prefixes[(size_t)task * depth];
+		bool partway = start != nullptr;
+		for (int j = 0; j < depth && partway; j++)
+			partway = prefix[j] == start[j];
+		if (partway)
+		{
+			for (int j = 0; j < Length; j++)
+				permutation[j] = start[j];
+		}
+		else
+			completePrefix<Length, First>(prefix, depth, permutation);
+	};
+
+	// Test the first permutation of each task in order before the workers start, as the
+	// serial search would. A task whose prefix fails skips the tasks after it that share
+	// the digits up to the failed one without testing them, so no permutation is tested
+	// that the serial search does not test.
+	const int SKIPPED_TASK = -2;
+	std::vector<int> firstFailures(taskCount, SKIPPED_TASK);
+	{
+		Predicate firstIsValid = isValid;
+		int permutation[Length];
+		int task = 0;
+		while (task < taskCount)
+		{
+			taskStart(task, permutation);
+			int failedIndex = firstIsValid(permutation, 0);
+			BAUER_COUNT(countRowTest(0, failedIndex));
+			firstFailures[task++] = failedIndex;
+			if (failedIndex < 0 || failedIndex >= depth)
+				continue;
+			while (task < taskCount)
+			{
+				const int* prefix = &prefixes[(size_t)task * depth];
+				bool shared = true;
+				for (int j = 0; j <= failedIndex && shared; j++)
+					shared = prefix[j] == permutation[j];
+				if (!shared)
+					break;
+				task++;
+			}
+		}
+	}
+
+	// give each worker an even share of the tasks
+	std::vector<std::unique_ptr<PrefixTaskQueue>> queues;
+	for (unsigned int i = 0; i < threads; i++)
+	{
+		queues.emplace_back(new PrefixTaskQueue);
+		queues[i]->begin = (int)((long long)taskCount * i / threads);
+		queues[i]->end = (int)((long long)taskCount * (i + 1) / threads);
+	}
+
+	std::vector<RowArena> results(taskCount, RowArena(Length));
+	std::vector<char> finished(taskCount, 0);
+	std::mutex flushLock;
+	int flushed = 0;
+	std::vector<std::thread> workers;
+	for (unsigned int i = 0; i < threads; i++)
+	{
+		workers.emplace_back([&, i]()
+		{
+			int task;
+			while (takePrefixTask(queues, i, task))
+			{
+				int permutation[Length];
+				taskStart(task, permutation);
+
+				// Carry on from the test of the first permutation. The predicate is a new copy,
+				// since another copy made that test. The prefix of the task stays fixed, so the
+				// search stops at the end of the task.
+				Predicate taskIsValid = isValid;
+				int failedIndex = firstFailures[task];
+				bool more = failedIndex == -1 || (failedIndex >= depth && nextRow<Length, First>(permutation, taskIsValid, failedIndex, depth));
+				while (more)
+				{
+					results[task].write(permutation);
+					more = nextRow<Length, First>(permutation, taskIsValid, -1, depth);
+				}
+
+				BAUER_COUNT(mergeSearchStats());
+
+				// write out every task that is now finished in order
+				std::lock_guard<std::mutex> guard(flushLock);
+				finished[task] = 1;
+				while (flushed < taskCount && finished[flushed])
+				{
+					for (size_t j = 0; j < results[flushed].size(); j++)
+					{
+						int row[Length];
+						for (int k = 0; k < Length; k++)
+							row[k] = results[flushed][j][k];
+						sink.write(row);
+					}
+					results[flushed].clear();
+					flushed++;
+				}
+				if (checkpoint != nullptr && flushed < taskCount)
+				{
+					int position[Length];
+					taskStart(flushed, position);
+					checkpoint->update(position);
+				}
+			}
+		});
+	}
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+#endif
@@ -0,0 +1,379 @@
+/*
+* File: bauer_perf.h
+* Author: Jeff Martin
+*
+* This file contains a profiling mode that reads the hardware performance
+* counters of Linux through perf_event_open, with no outside tools. Each
+* serial search is run in separate passes so each phase is measured on its
+* own. A first pass records every permutation the enumerator hands to the
+* predicate and what the predicate answered. The enumeration phase runs the
+* enumerator again with a predicate that only plays back those answers, so it
+* takes the same steps without validating anything. The validation phase runs
+* the predicate alone over the recorded permutations, in the same order. The
+* output phase writes the rows through the RowFileWriter that the searches
+* use. Each phase also pays for reading back what was recorded, which is a
+* load or two per permutation. On other systems, or when the kernel does not
+* allow a counter, that counter is left out of the report, and the time of
+* each phase comes from the steady clock.
+*
+* Copyright  2022 by Jeffrey Martin. All rights reserved.
+* Email: jmartin@jeffreymartincomposer.com
+* Website: https://jeffreymartincomposer.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BAUERPERF
+#define BAUERPERF
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "bauer_algorithm.h"
+#include "bauer_trichord.h"
+#include "bauer_trichord_ten.h"
+#include "bauer_trichord_babbitt.h"
+
+// the counters read in each phase. The task clock is in nanoseconds.
+const int PERF_TASK_CLOCK = 0;
+const int PERF_CYCLES = 1;
+const int PERF_INSTRUCTIONS = 2;
+const int PERF_BRANCH_MISSES = 3;
+const int PERF_L1_MISSES = 4;
+const int PERF_COUNTERS = 5;
+
+/// <summary>
+/// The values of the counters over one phase. A counter the kernel would not open is -1,
+/// except the task clock, which falls back on the steady clock.
+/// </summary>
+struct PerfSample
+{
+	double values[PERF_COUNTERS];
+
+	/// <summary>
+	/// Subtracts another sample from this one, keeping unavailable counters unavailable
+	/// and differences that come out negative at zero
+	/// </summary>
+	/// <param name="other">The other sample</param>
+	/// <returns>The difference</returns>
+	PerfSample minus(const PerfSample& other) const
+	{
+		PerfSample difference;
+		for (int i = 0; i < PERF_COUNTERS; i++)
+		{
+			if (values[i] < 0 || other.values[i] < 0)
+				difference.values[i] = -1;
+			else
+				difference.values[i] = values[i] > other.values[i] ? values[i] - other.values[i] : 0;
+		}
+		return difference;
+	}
+};
+
+/// <summary>
+/// A set of performance counters for the calling thread, in user space only
+/// </summary>
+class PerfCounters
+{
+public:
+	PerfCounters()
+	{
+		for (int i = 0; i < PERF_COUNTERS; i++)
+			descriptors[i] = -1;
+#ifdef __linux__
+		const uint32_t types[PERF_COUNTERS] = { PERF_TYPE_SOFTWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE };
+		const uint64_t configs[PERF_COUNTERS] =
+		{
+			PERF_COUNT_SW_TASK_CLOCK,
+			PERF_COUNT_HW_CPU_CYCLES,
+			PERF_COUNT_HW_INSTRUCTIONS,
+			PERF_COUNT_HW_BRANCH_MISSES,
+			PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+		};
+		for (int i = 0; i < PERF_COUNTERS; i++)
+		{
+			struct perf_event_attr attributes;
+			std::memset(&attributes, 0, sizeof(attributes));
+			attributes.size = sizeof(attributes);
+			attributes.type = types[i];
+			attributes.config = configs[i];
+			attributes.disabled = 1;
+			attributes.exclude_kernel = 1;
+			attributes.exclude_hv = 1;
+			attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			descriptors[i] = (int)syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+		}
+#endif
+	}
+
+	~PerfCounters()
+	{
+#ifdef __linux__
+		for (int i = 0; i < PERF_COUNTERS; i++)
+		{
+			if (descriptors[i] >= 0)
+				close(descriptors[i]);
+		}
+#endif
+	}
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	/// <summary>
+	/// Determines if the hardware counters could be opened
+	/// </summary>
+	/// <returns>True if the cycle counter is available</returns>
+	bool available() const
+	{
+		return descriptors[PERF_CYCLES] >= 0;
+	}
+
+	/// <summary>
+	/// Clears the counters and starts them
+	/// </summary>
+	void start()
+	{
+		started = std::chrono::steady_clock::now();
+#ifdef __linux__
+		for (int i = 0; i < PERF_COUNTERS; i++)
+		{
+			if (descriptors[i] >= 0)
+			{
+				ioctl(descriptors[i], PERF_EVENT_IOC_RESET, 0);
+				ioctl(descriptors[i], PERF_EVENT_IOC_ENABLE, 0);
+			}
+		}
+#endif
+	}
+
+	/// <summary>
+	/// Stops the counters and reads them. If the kernel had to share a counter with other
+	/// events, its value is scaled up to the whole phase.
+	/// </summary>
+	/// <returns>The values of the counters</returns>
+	PerfSample stop()
+	{
+		PerfSample sample;
+		for (int i = 0; i < PERF_COUNTERS; i++)
+			sample.values[i] = -1;
+#ifdef __linux__
+		for (int i = 0; i < PERF_COUNTERS; i++)
+		{
+			if (descriptors[i] >= 0)
+				ioctl(descriptors[i], PERF_EVENT_IOC_DISABLE, 0);
+		}
+		for (int i = 0; i < PERF_COUNTERS; i++)
+		{
+			uint64_t reading[3];
+			if (descriptors[i] < 0 || read(descriptors[i], reading, sizeof(reading)) != (ssize_t)sizeof(reading))
+				continue;
+			sample.values[i] = reading[2] > 0 ? (double)reading[0] * reading[1] / reading[2] : 0;
+		}
+#endif
+		if (sample.values[PERF_TASK_CLOCK] < 0)
+			sample.values[PERF_TASK_CLOCK] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+		return sample;
+	}
+
+private:
+	int descriptors[PERF_COUNTERS];
+	std::chrono::steady_clock::time_point started;
+};
+
+/// <summary>
+/// Records each permutation a predicate is called on, packed four bits to a digit with
+/// the index to check from in the top four bits, and the index the predicate returned
+/// </summary>
+template <typename Predicate>
+struct RecordingPredicate
+{
+	Predicate isValid;
+	std::vector<uint64_t>* candidates;
+	std::vector<int8_t>* answers;
+	int length;
+
+	RecordingPredicate(const Predicate& isValid, std::vector<uint64_t>& candidates, std::vector<int8_t>& answers, int length) : isValid(isValid), candidates(&candidates), answers(&answers), length(length) {}
+
+	int operator()(int* permutation, int from)
+	{
+		uint64_t packed = (uint64_t)from << 60;
+		for (int i = 0; i < length; i++)
+			packed |= (uint64_t)permutation[i] << (4 * i);
+		int failedIndex = isValid(permutation, from);
+		candidates->push_back(packed);
+		answers->push_back((int8_t)failedIndex);
+		return failedIndex;
+	}
+};
+
+/// <summary>
+/// Plays back the answers a RecordingPredicate recorded, so the enumerator takes the
+/// same steps without any validation
+/// </summary>
+struct ReplayPredicate
+{
+	const int8_t* answers;
+	size_t next;
+
+	ReplayPredicate(const std::vector<int8_t>& answers) : answers(answers.data()), next(0) {}
+
+	int operator()(int*, int)
+	{
+		return answers[next++];
+	}
+};
+
+template <int Length, int First, typename Predicate, typename Finished>
+static void runProfiledSearch(Predicate& isValid, Finished finished, RowArena* found);
+static void printPerfPhase(const char* phase, const PerfSample& sample, uint64_t units, const char* unitName);
+template <int Length, int First, typename Predicate, typename Finished>
+void profileGenerator(std::string name, const Predicate& isValid, Finished finished, std::string destinationFile);
+void profileGenerators(std::string directory);
+
+/// <summary>
+/// Profiles the all-interval, all-trichord, Babbitt all-trichord and ten-trichord searches
+/// </summary>
+/// <param name="directory">The directory to write the JSON files to while measuring the output</param>
+void profileGenerators(std::string directory)
+{
+	PerfCounters probe;
+	if (!probe.available())
+		std::cout << "The hardware counters are not available, so only the time is reported.\n";
+
+	std::string prefix = directory.empty() ? "" : directory + "/";
+	profileGenerator<11, 1>("allInterval", AllIntervalPredicate(), [](const int* permutation) { return permutation[0] >= 6; }, prefix + "profile_all_interval.json");
+	profileGenerator<12, 0>("allTrichord", TrichordRowPredicate(TRICHORD_TABLE), [](const int* permutation) { return permutation[1] >= 6; }, prefix + "profile_all_trichord.json");
+	profileGenerator<12, 0>("babbitt", BabbittTrichordRowPredicate(TRICHORD_TABLE), [](const int* permutation) { return permutation[1] >= 6 && permutation[2] >= 6; }, prefix + "profile_babbitt.json");
+	profileGenerator<12, 0>("tenTrichord", TenTrichordRowPredicate(TRICHORD_TABLE), [](const int* permutation) { return permutation[1] >= 6 && permutation[2] >= 6; }, prefix + "profile_ten_trichord.json");
+}
+
+/// <summary>
+/// Profiles one serial search phase by phase and prints the counters
+/// </summary>
+/// <typeparam name="Length">The number of digits in the permutation</typeparam>
+/// <typeparam name="First">The smallest digit in the permutation</typeparam>
+/// <param name="name">The name of the search</param>
+/// <param name="isValid">The predicate</param>
+/// <param name="finished">True once the permutation is past the end of the search</param>
+/// <param name="destinationFile">The file to write the rows to, in binary if it ends in .bin and in JSON otherwise</param>
+template <int Length, int First, typename Predicate, typename Finished>
+void profileGenerator(std::string name, const Predicate& isValid, Finished finished, std::string destinationFile)
+{
+	static_assert(Length < 16 && First + Length <= 16, "Each digit and the index to check from must fit in four bits");
+	PerfCounters counters;
+	RowArena found(Length);
+
+	// record the permutations the predicate is called on and its answers, and find the
+	// rows to write later. This pass also warms up the caches.
+	std::vector<uint64_t> candidates;
+	std::vector<int8_t> answers;
+	RecordingPredicate<Predicate> recording(isValid, candidates, answers, Length);
+	runProfiledSearch<Length, First>(recording, finished, &found);
+
+	counters.start();
+	ReplayPredicate replay(answers);
+	runProfiledSearch<Length, First>(replay, finished, nullptr);
+	PerfSample enumeration = counters.stop();
+
+	counters.start();
+	Predicate validator(isValid);
+	int permutation[Length];
+	int failures = 0;
+	for (size_t i = 0; i < candidates.size(); i++)
+	{
+		// the digits before the index to check from are the same as in the last permutation
+		uint64_t packed = candidates[i];
+		int from = (int)(packed >> 60);
+		for (int j = i == 0 ? 0 : from; j < Length; j++)
+			permutation[j] = (int)(packed >> (4 * j) & 0xF);
+		if (validator(permutation, from) >= 0)
+			failures++;
+	}
+	PerfSample validation = counters.stop();
+
+	counters.start();
+	RowFileWriter writer(destinationFile, name, First + Length, Length);
+	for (size_t i = 0; i < found.size(); i++)
+	{
+		for (int j = 0; j < Length; j++)
+			permutation[j] = found[i][j];
+		writer.write(permutation);
+	}
+	writer.close();
+	PerfSample output = counters.stop();
+
+	std::cout << name << ": " << candidates.size() << " nodes, " << found.size() << " rows, " << failures << " rejected\n";
+	printPerfPhase("enumeration", enumeration, candidates.size(), "node");
+	printPerfPhase("validation", validation, candidates.size(), "node");
+	printPerfPhase("output", output, found.size(), "row");
+}
+
+/// <summary>
+/// Runs a serial search
+/// </summary>
+/// <param name="isValid">The predicate</param>
+/// <param name="finished">True once the permutation is past the end of the search</param>
+/// <param name="found">An arena to keep the rows in, or null</param>
+template <int Length, int First, typename Predicate, typename Finished>
+static void runProfiledSearch(Predicate& isValid, Finished finished, RowArena* found)
+{
+	int permutation[Length];
+	for (int i = 0; i < Length; i++)
+		permutation[i] = First + i;
+	nextRow<Length, First>(permutation, isValid);
+	while (!finished(permutation))
+	{
+		if (found)
+			found->write(permutation);
+		nextRow<Length, First>(permutation, isValid);
+	}
+}
+
+/// <summary>
+/// Prints the counters of one phase
+/// </summary>
+/// <param name="phase">The name of the phase</param>
+/// <param name="sample">The counters</param>
+/// <param name="units">The number of nodes or rows in the phase</param>
+/// <param name="unitName">What the units are called</param>
+static void printPerfPhase(const char* phase, const PerfSample& sample, uint64_t units, const char* unitName)
+{
+	const double* values = sample.values;
+	char line[256];
+	int length = std::snprintf(line, sizeof(line), "  %-14s %9.3f ms", phase, values[PERF_TASK_CLOCK] / 1e6);
+	if (values[PERF_CYCLES] >= 0 && values[PERF_INSTRUCTIONS] >= 0)
+		length += std::snprintf(line + length, sizeof(line) - length, "  %.2f IPC", values[PERF_CYCLES] > 0 ? values[PERF_INSTRUCTIONS] / values[PERF_CYCLES] : 0);
+	if (units > 0)
+	{
+		if (values[PERF_CYCLES] >= 0)
+			length += std::snprintf(line + length, sizeof(line) - length, "  %.1f cycles/%s", values[PERF_CYCLES] / units, unitName);
+		if (values[PERF_BRANCH_MISSES] >= 0)
+			length += std::snprintf(line + length, sizeof(line) - length, "  %.3f branch misses/%s", values[PERF_BRANCH_MISSES] / units, unitName);
+		if (values[PERF_L1_MISSES] >= 0)
+			length += std::snprintf(line + length, sizeof(line) - length, "  %.3f L1 misses/%s", values[PERF_L1_MISSES] / units, unitName);
+	}
+	std::cout << line << "\n";
+}
+
+#endif
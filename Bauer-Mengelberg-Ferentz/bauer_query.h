@@ -0,0 +1,209 @@
+/*
+* File: bauer_query.h
+* Author: Jeff Martin
+*
+* This file contains queries for a few twelve-tone rows of a kind, rather
+* than all of them. A query can fix the pc at any index, forbid intervals
+* between adjacent pcs, and stop after a number of rows. The enumerator starts
+* at the first row that begins with the fixed prefix, and a row that breaks
+* the query is skipped at the first index that breaks it, so a query with a
+* prefix or a small limit only looks at a small part of the space. Queries
+* cover every row, not only the rows a generator writes, which begin with 0
+* and leave out the inversions.
+*
+* Copyright  2022 by Jeffrey Martin. All rights reserved.
+* Email: jmartin@jeffreymartincomposer.com
+* Website: https://jeffreymartincomposer.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BAUERQUERY
+#define BAUERQUERY
+#include <cstddef>
+#include <stdexcept>
+#include "bauer_engine.h"
+#include "bauer_parallel.h"
+#include "bauer_trichord.h"
+#include "bauer_trichord_babbitt.h"
+#include "bauer_trichord_ten.h"
+
+/// <summary>
+/// The rows a query asks for
+/// </summary>
+struct RowQuery
+{
+	// the pc each index must have, or -1 for any pc
+	int fixed[12];
+
+	// a bitmask of the intervals that may not appear between adjacent pcs
+	int forbiddenIntervals;
+
+	// the most rows to find, or 0 for every row
+	size_t limit;
+
+	RowQuery() : forbiddenIntervals(0), limit(0)
+	{
+		for (int i = 0; i < 12; i++)
+			fixed[i] = -1;
+	}
+};
+
+/// <summary>
+/// Wraps the predicate of a kind of row so that it also checks a query. The query is
+/// checked first, and the predicate is only called for rows that meet it.
+/// </summary>
+/// <typeparam name="Predicate">The type of the predicate</typeparam>
+template <typename Predicate>
+struct QueryPredicate
+{
+	Predicate isValid;
+	const RowQuery* query;
+
+	// a bitmask of the pcs the query fixes at some index
+	int reserved;
+
+	// the index of the first pc that changed since the predicate was last called
+	int pending;
+
+	QueryPredicate(const Predicate& isValid, const RowQuery& query) : isValid(isValid), query(&query), reserved(0), pending(0)
+	{
+		for (int i = 0; i < 12; i++)
+		{
+			if (query.fixed[i] >= 0)
+				reserved |= 1 << query.fixed[i];
+		}
+	}
+
+	/// <summary>
+	/// Determines if a twelve-tone row meets the query and is a row of the kind
+	/// </summary>
+	/// <param name="permutation">A twelve-tone row</param>
+	/// <param name="from">The index of the first pc that changed since the last call</param>
+	/// <returns>The index of the pc that failed, or -1 if the row is valid</returns>
+	int operator()(int* permutation, int from)
+	{
+		// the pcs before from met the query on the last call
+		if (from < pending)
+			pending = from;
+		for (int i = from; i < 12; i++)
+		{
+			// a pc fixed at a later index cannot be used here
+			int pc = permutation[i];
+			if (query->fixed[i] >= 0 ? pc != query->fixed[i] : ((reserved >> pc) & 1) != 0)
+				return i;
+			if (i > 0)
+			{
+				int interval = pc - permutation[i - 1];
+				if (interval < 0)
+					interval += 12;
+				if ((query->forbiddenIntervals >> interval) & 1)
+					return i;
+			}
+		}
+		int failedIndex = isValid(permutation, pending);
+		pending = 12;
+		return failedIndex;
+	}
+};
+
+template <typename Predicate, typename Sink>
+size_t queryRows(const Predicate& isValid, const RowQuery& query, Sink& sink);
+template <typename Sink>
+size_t queryAllTrichordRows(const RowQuery& query, Sink& sink);
+template <typename Sink>
+size_t queryBabbittAllTrichordRows(const RowQuery& query, Sink& sink);
+template <typename Sink>
+size_t queryTenTrichordRows(const RowQuery& query, Sink& sink);
+
+/// <summary>
+/// Finds the all-trichord rows that meet a query, in lexicographic order
+/// </summary>
+/// <param name="query">The query</param>
+/// <param name="sink">The sink to write the rows to</param>
+/// <returns>The number of rows found</returns>
+template <typename Sink>
+size_t queryAllTrichordRows(const RowQuery& query, Sink& sink)
+{
+	return queryRows(TrichordRowPredicate(TRICHORD_TABLE), query, sink);
+}
+
+/// <summary>
+/// Finds the Babbitt all-trichord rows that meet a query, in lexicographic order
+/// </summary>
+/// <param name="query">The query</param>
+/// <param name="sink">The sink to write the rows to</param>
+/// <returns>The number of rows found</returns>
+template <typename Sink>
+size_t queryBabbittAllTrichordRows(const RowQuery& query, Sink& sink)
+{
+	return queryRows(BabbittTrichordRowPredicate(TRICHORD_TABLE), query, sink);
+}
+
+/// <summary>
+/// Finds the ten-trichord rows that meet a query, in lexicographic order
+/// </summary>
+/// <param name="query">The query</param>
+/// <param name="sink">The sink to write the rows to</param>
+/// <returns>The number of rows found</returns>
+template <typename Sink>
+size_t queryTenTrichordRows(const RowQuery& query, Sink& sink)
+{
+	return queryRows(TenTrichordRowPredicate(TRICHORD_TABLE), query, sink);
+}
+
+/// <summary>
+/// Finds the twelve-tone rows of a kind that meet a query, in lexicographic order
+/// </summary>
+/// <param name="isValid">The predicate of the kind of row</param>
+/// <param name="query">The query</param>
+/// <param name="sink">The sink to write the rows to</param>
+/// <returns>The number of rows found</returns>
+template <typename Predicate, typename Sink>
+size_t queryRows(const Predicate& isValid, const RowQuery& query, Sink& sink)
+{
+	int used = 0;
+	for (int i = 0; i < 12; i++)
+	{
+		int pc = query.fixed[i];
+		if (pc < -1 || pc > 11 || (pc >= 0 && ((used >> pc) & 1)))
+			throw std::invalid_argument("A query must fix different pcs from 0 to 11");
+		if (pc >= 0)
+			used |= 1 << pc;
+	}
+
+	// start at the first row that begins with the fixed prefix
+	int prefixLength = 0;
+	while (prefixLength < 12 && query.fixed[prefixLength] >= 0)
+		prefixLength++;
+	int permutation[12];
+	completePrefix<12, 0>(query.fixed, prefixLength, permutation);
+
+	// every row the enumerator stops at meets the query, and once the rows no longer
+	// begin with the prefix, each prefix left is skipped with one call
+	QueryPredicate<Predicate> queryIsValid(isValid, query);
+	size_t found = 0;
+	bool more = seekRow<12, 0>(permutation, queryIsValid);
+	while (more)
+	{
+		sink.write(permutation);
+		found++;
+		if (found == query.limit)
+			break;
+		more = nextRow<12, 0>(permutation, queryIsValid);
+	}
+	return found;
+}
+
+#endif
@@ -0,0 +1,257 @@
+/*
+* File: bauer_setclass.h
+* Author: Jeff Martin
+*
+* This file contains set-class tables for trichords, tetrachords and
+* pentachords, built by the compiler. Each set class is given by one of its
+* members in Forte order, and every transposition and inversion of it is
+* marked with its Forte ordinal in a table of all 4096 pc sets. The chord
+* tables are keyed by the intervals between consecutive pcs, as the trichord
+* table always has been, and are stored as bytes in read-only memory, so
+* there is nothing to build at start-up. The static_asserts below check that
+* the classes of each size are all different and together hold every set.
+*
+* Copyright  2022 by Jeffrey Martin. All rights reserved.
+* Email: jmartin@jeffreymartincomposer.com
+* Website: https://jeffreymartincomposer.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BAUERSETCLASS
+#define BAUERSETCLASS
+#include <cstdint>
+
+// The number of set classes of each size
+const int TRICHORD_CLASSES = 12;
+const int TETRACHORD_CLASSES = 29;
+const int PENTACHORD_CLASSES = 38;
+
+// Forte's prime forms, in the order of his numbering
+constexpr const char* TRICHORD_PRIME_FORMS[TRICHORD_CLASSES] =
+{
+	"012", "013", "014", "015", "016", "024", "025", "026", "027", "036", "037", "048"
+};
+constexpr const char* TETRACHORD_PRIME_FORMS[TETRACHORD_CLASSES] =
+{
+	"0123", "0124", "0134", "0125", "0126", "0127", "0145", "0156", "0167", "0235",
+	"0135", "0236", "0136", "0237", "0146", "0157", "0347", "0147", "0148", "0158",
+	"0246", "0247", "0257", "0248", "0268", "0358", "0258", "0369", "0137"
+};
+constexpr const char* PENTACHORD_PRIME_FORMS[PENTACHORD_CLASSES] =
+{
+	"01234", "01235", "01245", "01236", "01237", "01256", "01267", "02346", "01246", "01346",
+	"02347", "01356", "01248", "01257", "01268", "01347", "01348", "01457", "01367", "01378",
+	"01458", "01478", "02357", "01357", "02358", "02458", "01358", "02368", "01368", "01468",
+	"01369", "01469", "02468", "02469", "02479", "01247", "03458", "01258"
+};
+
+/// <summary>
+/// The Forte ordinal of every pc set of three to five pcs, indexed by the bitmask of the set
+/// </summary>
+struct SetClassMap
+{
+	uint8_t classes[4096];
+
+	// true if a set was given to two classes, which means a prime form above is wrong
+	bool conflict;
+};
+
+/// <summary>
+/// A table of the Forte ordinals of the chords of one size, indexed by the intervals
+/// between consecutive pcs. The first interval is the most significant digit in base 12.
+/// A chord that repeats a pc has ordinal 0.
+/// </summary>
+/// <typeparam name="Size">The number of pcs in each chord</typeparam>
+template <int Size>
+struct ChordClassTable
+{
+	uint8_t classes[Size == 3 ? 144 : Size == 4 ? 1728 : 20736];
+};
+
+constexpr SetClassMap buildSetClassMap();
+template <int Size>
+constexpr ChordClassTable<Size> buildChordClassTable();
+constexpr int countClassifiedSets(const SetClassMap& map, int size);
+constexpr int parsePrimeForm(const char* form);
+constexpr int transformSet(int set, int shift, bool inverted);
+inline int pentachordClass(int first, int second, int third, int fourth);
+inline int setClass(int set);
+inline int tetrachordClass(int first, int second, int third);
+inline int trichordClass(int first, int second);
+
+/// <summary>
+/// Converts a prime form such as "0137" to a bitmask of pcs
+/// </summary>
+/// <param name="form">The pcs of the prime form, one digit each</param>
+/// <returns>The bitmask</returns>
+constexpr int parsePrimeForm(const char* form)
+{
+	int set = 0;
+	for (int i = 0; form[i] != '\0'; i++)
+		set |= 1 << (form[i] - '0');
+	return set;
+}
+
+/// <summary>
+/// Transposes a pc set, after inverting it if asked
+/// </summary>
+/// <param name="set">The bitmask of the set</param>
+/// <param name="shift">The interval of transposition</param>
+/// <param name="inverted">True to invert the set first</param>
+/// <returns>The bitmask of the transformed set</returns>
+constexpr int transformSet(int set, int shift, bool inverted)
+{
+	int image = 0;
+	for (int pc = 0; pc < 12; pc++)
+	{
+		if ((set >> pc) & 1)
+			image |= 1 << ((inverted ? 12 - pc + shift : pc + shift) % 12);
+	}
+	return image;
+}
+
+/// <summary>
+/// Marks every transposition and inversion of the prime forms with their Forte ordinals
+/// </summary>
+/// <returns>The map of all pc sets</returns>
+constexpr SetClassMap buildSetClassMap()
+{
+	SetClassMap map = {};
+	const char* const* forms[3] = { TRICHORD_PRIME_FORMS, TETRACHORD_PRIME_FORMS, PENTACHORD_PRIME_FORMS };
+	const int counts[3] = { TRICHORD_CLASSES, TETRACHORD_CLASSES, PENTACHORD_CLASSES };
+	for (int size = 0; size < 3; size++)
+	{
+		for (int i = 0; i < counts[size]; i++)
+		{
+			int set = parsePrimeForm(forms[size][i]);
+			for (int shift = 0; shift < 24; shift++)
+			{
+				int image = transformSet(set, shift % 12, shift >= 12);
+				if (map.classes[image] != 0 && map.classes[image] != i + 1)
+					map.conflict = true;
+				map.classes[image] = (uint8_t)(i + 1);
+			}
+		}
+	}
+	return map;
+}
+
+/// <summary>
+/// Counts the sets of one size that have been given a class
+/// </summary>
+/// <param name="map">The map of all pc sets</param>
+/// <param name="size">The number of pcs</param>
+/// <returns>The number of sets</returns>
+constexpr int countClassifiedSets(const SetClassMap& map, int size)
+{
+	int count = 0;
+	for (int set = 0; set < 4096; set++)
+	{
+		int pcs = 0;
+		for (int pc = 0; pc < 12; pc++)
+			pcs += (set >> pc) & 1;
+		if (pcs == size && map.classes[set] != 0)
+			count++;
+	}
+	return count;
+}
+
+constexpr SetClassMap SET_CLASS_MAP = buildSetClassMap();
+static_assert(!SET_CLASS_MAP.conflict, "Two prime forms belong to the same set class");
+static_assert(countClassifiedSets(SET_CLASS_MAP, 3) == 220, "The trichord prime forms do not cover every trichord");
+static_assert(countClassifiedSets(SET_CLASS_MAP, 4) == 495, "The tetrachord prime forms do not cover every tetrachord");
+static_assert(countClassifiedSets(SET_CLASS_MAP, 5) == 792, "The pentachord prime forms do not cover every pentachord");
+
+/// <summary>
+/// Looks up the Forte ordinal of every chord of one size by its consecutive intervals
+/// </summary>
+/// <typeparam name="Size">The number of pcs in each chord, from 3 to 5</typeparam>
+/// <returns>The chord table</returns>
+template <int Size>
+constexpr ChordClassTable<Size> buildChordClassTable()
+{
+	ChordClassTable<Size> table = {};
+	int keys = (int)sizeof(table.classes);
+	for (int key = 0; key < keys; key++)
+	{
+		// the last interval is the least significant digit, so walk the intervals backward
+		// from the last pc, which gives a transposition of the same chord
+		int set = 1;
+		int pc = 0;
+		bool distinct = true;
+		for (int rest = key, i = 0; i < Size - 1; rest /= 12, i++)
+		{
+			pc = (pc + 12 - rest % 12) % 12;
+			if ((set >> pc) & 1)
+				distinct = false;
+			set |= 1 << pc;
+		}
+		table.classes[key] = distinct ? SET_CLASS_MAP.classes[set] : 0;
+	}
+	return table;
+}
+
+constexpr ChordClassTable<3> TRICHORD_TABLE = buildChordClassTable<3>();
+constexpr ChordClassTable<4> TETRACHORD_TABLE = buildChordClassTable<4>();
+constexpr ChordClassTable<5> PENTACHORD_TABLE = buildChordClassTable<5>();
+static_assert(TRICHORD_TABLE.classes[1 * 12 + 1] == 1 && TRICHORD_TABLE.classes[3 * 12 + 4] == 11 && TRICHORD_TABLE.classes[4 * 12 + 4] == 12, "The trichord table is wrong");
+
+/// <summary>
+/// Gets the Forte ordinal of a pc set of three to five pcs
+/// </summary>
+/// <param name="set">The bitmask of the set</param>
+/// <returns>The ordinal, from 1, or 0 for a set of another size</returns>
+inline int setClass(int set)
+{
+	return SET_CLASS_MAP.classes[set];
+}
+
+/// <summary>
+/// Gets the Forte ordinal of a trichord
+/// </summary>
+/// <param name="first">The interval from the first pc to the second</param>
+/// <param name="second">The interval from the second pc to the third</param>
+/// <returns>The ordinal from 1 to 12, or 0 if a pc repeats</returns>
+inline int trichordClass(int first, int second)
+{
+	return TRICHORD_TABLE.classes[first * 12 + second];
+}
+
+/// <summary>
+/// Gets the Forte ordinal of a tetrachord
+/// </summary>
+/// <param name="first">The interval from the first pc to the second</param>
+/// <param name="second">The interval from the second pc to the third</param>
+/// <param name="third">The interval from the third pc to the fourth</param>
+/// <returns>The ordinal from 1 to 29, or 0 if a pc repeats</returns>
+inline int tetrachordClass(int first, int second, int third)
+{
+	return TETRACHORD_TABLE.classes[(first * 12 + second) * 12 + third];
+}
+
+/// <summary>
+/// Gets the Forte ordinal of a pentachord
+/// </summary>
+/// <param name="first">The interval from the first pc to the second</param>
+/// <param name="second">The interval from the second pc to the third</param>
+/// <param name="third">The interval from the third pc to the fourth</param>
+/// <param name="fourth">The interval from the fourth pc to the fifth</param>
+/// <returns>The ordinal from 1 to 38, or 0 if a pc repeats</returns>
+inline int pentachordClass(int first, int second, int third, int fourth)
+{
+	return PENTACHORD_TABLE.classes[((first * 12 + second) * 12 + third) * 12 + fourth];
+}
+
+#endif
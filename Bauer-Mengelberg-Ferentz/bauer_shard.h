@@ -0,0 +1,179 @@
+/*
+* File: bauer_shard.h
+* Author: Jeff Martin
+*
+* This file contains the shards of a search, for spreading one search over
+* several processes or machines that share nothing. The prefixes of the
+* search are listed in lexicographic order and cut into equal ranges, one per
+* shard. The ranges depend only on the number of shards, so every process
+* works out its own range from "--shard i/n" without talking to the others.
+* Each shard is written to its own file, and since the ranges are in order,
+* the shard files can be merged into the file a single search would write.
+*
+* Copyright  2022 by Jeffrey Martin. All rights reserved.
+* Email: jmartin@jeffreymartincomposer.com
+* Website: https://jeffreymartincomposer.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BAUERSHARD
+#define BAUERSHARD
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "bauer_parallel.h"
+
+/// <summary>
+/// One shard of a search: shard index of count
+/// </summary>
+struct SearchShard
+{
+	int index;
+	int count;
+};
+
+// the shard that covers the whole search
+const SearchShard WHOLE_SEARCH = { 0, 1 };
+
+template <int Length, int First>
+int findShardRange(SearchShard shard, const int* endPrefix, int endLength, int* start, int* shardEnd);
+inline bool isBeforePrefix(const int* permutation, const int* prefix, int length);
+SearchShard parseShard(std::string text);
+std::string shardFileName(std::string path, SearchShard shard);
+std::string shardSearchName(std::string name, SearchShard shard);
+
+/// <summary>
+/// Reads a shard written as "index/count", with the index counting from 0
+/// </summary>
+/// <param name="text">The text of the shard</param>
+/// <returns>The shard</returns>
+SearchShard parseShard(std::string text)
+{
+	size_t slash = text.find('/');
+	SearchShard shard = { -1, 0 };
+	try
+	{
+		size_t used = 0;
+		shard.index = std::stoi(text.substr(0, slash), &used);
+		if (slash == std::string::npos || used != slash)
+			throw std::invalid_argument(text);
+		shard.count = std::stoi(text.substr(slash + 1), &used);
+		if (used != text.size() - slash - 1)
+			throw std::invalid_argument(text);
+	}
+	catch (const std::logic_error&)
+	{
+		throw std::invalid_argument("A shard must be written as index/count, not " + text);
+	}
+	if (shard.count < 1 || shard.index < 0 || shard.index >= shard.count)
+		throw std::invalid_argument("The shard index must be from 0 to one less than the number of shards");
+	return shard;
+}
+
+/// <summary>
+/// Gets the output file of a shard, which is the output file of the whole search with
+/// the shard added before the extension
+/// </summary>
+/// <param name="path">The output file of the whole search</param>
+/// <param name="shard">The shard</param>
+/// <returns>The output file of the shard</returns>
+std::string shardFileName(std::string path, SearchShard shard)
+{
+	if (shard.count == 1)
+		return path;
+	size_t dot = path.find_last_of('.');
+	size_t separator = path.find_last_of("/\\");
+	if (dot == std::string::npos || (separator != std::string::npos && dot < separator))
+		dot = path.size();
+	return path.substr(0, dot) + ".shard" + std::to_string(shard.index) + "of" + std::to_string(shard.count) + path.substr(dot);
+}
+
+/// <summary>
+/// Gets the name a checkpoint of a shard is saved under, so a shard only resumes its own checkpoint
+/// </summary>
+/// <param name="name">The name of the generator</param>
+/// <param name="shard">The shard</param>
+/// <returns>The name of the search</returns>
+std::string shardSearchName(std::string name, SearchShard shard)
+{
+	if (shard.count == 1)
+		return name;
+	return name + "/" + std::to_string(shard.index) + "of" + std::to_string(shard.count);
+}
+
+/// <summary>
+/// Finds the permutations one shard of a search covers. The prefixes before the end
+/// prefix are split into equal ranges, with enough digits that every shard has several.
+/// </summary>
+/// <typeparam name="Length">The number of digits in the permutation</typeparam>
+/// <typeparam name="First">The smallest digit in the permutation</typeparam>
+/// <param name="shard">The shard</param>
+/// <param name="endPrefix">The first prefix the whole search does not cover</param>
+/// <param name="endLength">The number of digits in the end prefix</param>
+/// <param name="start">Set to the first permutation of the shard</param>
+/// <param name="shardEnd">Set to the first prefix after the shard, with room for Length digits</param>
+/// <returns>The number of digits in the prefix after the shard</returns>
+template <int Length, int First>
+int findShardRange(SearchShard shard, const int* endPrefix, int endLength, int* start, int* shardEnd)
+{
+	if (shard.count < 1 || shard.index < 0 || shard.index >= shard.count)
+		throw std::invalid_argument("The shard index must be from 0 to one less than the number of shards");
+
+	// the same rule the parallel search uses, so the ranges depend only on the number of shards
+	int depth = endLength;
+	std::vector<int> prefixes = listPrefixes<Length, First>(depth, endPrefix, endLength);
+	while (prefixes.size() / depth < (size_t)16 * shard.count && depth < Length - 2)
+	{
+		depth++;
+		prefixes = listPrefixes<Length, First>(depth, endPrefix, endLength);
+	}
+	size_t prefixCount = prefixes.size() / depth;
+	size_t first = prefixCount * shard.index / shard.count;
+	size_t last = prefixCount * (shard.index + 1) / shard.count;
+
+	// a shard with no prefixes starts where the next one does, so it finds nothing
+	if (first < prefixCount)
+		completePrefix<Length, First>(&prefixes[first * depth], depth, start);
+	else
+		completePrefix<Length, First>(endPrefix, endLength, start);
+	if (last < prefixCount)
+	{
+		for (int i = 0; i < depth; i++)
+			shardEnd[i] = prefixes[last * depth + i];
+		return depth;
+	}
+	for (int i = 0; i < endLength; i++)
+		shardEnd[i] = endPrefix[i];
+	return endLength;
+}
+
+/// <summary>
+/// Determines if a permutation comes before every permutation that begins with a prefix
+/// </summary>
+/// <param name="permutation">The permutation</param>
+/// <param name="prefix">The prefix</param>
+/// <param name="length">The number of digits in the prefix</param>
+/// <returns>True if the permutation comes first</returns>
+inline bool isBeforePrefix(const int* permutation, const int* prefix, int length)
+{
+	for (int i = 0; i < length; i++)
+	{
+		if (permutation[i] != prefix[i])
+			return permutation[i] < prefix[i];
+	}
+	return false;
+}
+
+#endif
@@ -0,0 +1,380 @@
+/*
+* File: bauer_simd.h
+* Author: Jeff Martin
+*
+* This file contains a vectorized check for batches of trichord rows. A row is
+* held in one 16-byte vector, one pc per byte. Its intervals come from one byte
+* subtraction, the set classes of its trichords from shuffle lookups into the
+* rows of the trichord table, and the trichords are different exactly when the
+* bits of their set classes add up to the number of trichords, and with AVX2
+* two rows are checked at once. The batched search below checks the 24
+* orderings of the last four pcs of each valid eight-pc prefix as one batch.
+* The AVX2 check is compiled for every x86 build and chosen at run time, so no
+* compiler flag is needed. A check one byte at a time is slower than the
+* incremental enumerator, so without AVX2 the batched search runs the
+* enumerator instead. Only the all-trichord search is batched. The
+* ten-trichord and Babbitt searches prune more of each prefix before the last
+* four pcs, and batching made them slower than the enumerator.
+*
+* Copyright  2022 by Jeffrey Martin. All rights reserved.
+* Email: jmartin@jeffreymartincomposer.com
+* Website: https://jeffreymartincomposer.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BAUERSIMD
+#define BAUERSIMD
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include "bauer_engine.h"
+#include "bauer_setclass.h"
+#include "bauer_shard.h"
+
+// the AVX2 check is compiled without /arch:AVX2 or -mavx2, and only run if the processor has AVX2
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define BAUER_AVX2_KERNEL
+#define BAUER_AVX2_TARGET
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BAUER_AVX2_KERNEL
+#define BAUER_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#ifdef BAUER_AVX2_KERNEL
+#include <immintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+inline bool hasVectorTrichordKernel();
+
+/// <summary>
+/// Determines if the processor can run the AVX2 check
+/// </summary>
+/// <returns>True if the AVX2 check was compiled and the processor and operating system support it</returns>
+inline bool hasVectorTrichordKernel()
+{
+#if defined(BAUER_AVX2_KERNEL) && defined(_MSC_VER)
+	static const bool supported = []
+	{
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+
+		// the processor has AVX, and the operating system saves the AVX registers
+		__cpuid(info, 1);
+		const int avx = (1 << 27) | (1 << 28);
+		if ((info[2] & avx) != avx || (_xgetbv(0) & 6) != 6)
+			return false;
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+	}();
+	return supported;
+#elif defined(BAUER_AVX2_KERNEL)
+	static const bool supported = __builtin_cpu_supports("avx2") != 0;
+	return supported;
+#else
+	return false;
+#endif
+}
+
+/// <summary>
+/// Counts the set bits of a bitmask
+/// </summary>
+/// <param name="bits">The bitmask</param>
+/// <returns>The number of set bits</returns>
+inline int countBits(unsigned int bits)
+{
+#ifdef _MSC_VER
+	return (int)__popcnt(bits);
+#else
+	return __builtin_popcount(bits);
+#endif
+}
+
+#ifdef BAUER_AVX2_KERNEL
+/// <summary>
+/// Checks batches of twelve-tone rows with AVX2 for trichords with different allowed set classes.
+/// A trichord has no Z-related partner, so its set class is fixed by its three interval
+/// classes, and the smallest two of them are enough to tell the twelve set classes apart.
+/// They are combined into an index below 16, so one shuffle finds the set class. Each
+/// 256-bit vector holds two rows, one in each lane.
+/// </summary>
+class TrichordBatchKernel
+{
+public:
+	/// <summary>
+	/// Prepares the lookup tables
+	/// </summary>
+	/// <param name="trichordTable">The trichord table</param>
+	/// <param name="cyclic">True if the trichords wrap around from the end of the row to its beginning</param>
+	/// <param name="excluded">A bitmask of the set classes that no trichord may have</param>
+	TrichordBatchKernel(const ChordClassTable<3>& trichordTable, bool cyclic, int excluded) : windows(cyclic ? 12 : 10), excluded(excluded)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			classes[i] = 0;
+			classBitsLow[i] = i < 8 ? (uint8_t)(1 << i) : 0;
+			classBitsHigh[i] = i >= 8 ? (uint8_t)(1 << (i - 8)) : 0;
+			windowMask[i] = i < windows ? 0xFF : 0;
+		}
+
+		// only pairs of intervals that do not return to the first pc occur
+		for (int first = 0; first < 12; first++)
+		{
+			for (int second = 0; second < 12; second++)
+			{
+				if (first > 0 && second > 0 && first + second != 12)
+					classes[classIndex(first, second)] = (uint8_t)(trichordTable.classes[first * 12 + second] - 1);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Checks a batch of rows
+	/// </summary>
+	/// <param name="rows">The rows, 16 bytes apart. Bytes 12 and 13 of each row repeat its first two pcs.</param>
+	/// <param name="count">The number of rows, an even number no more than 32</param>
+	/// <returns>A bitmask with bit i set if row i is valid</returns>
+	BAUER_AVX2_TARGET uint32_t check(const uint8_t (*rows)[16], int count) const
+	{
+		uint32_t valid = 0;
+		for (int i = 0; i < count; i += 2)
+		{
+			__m256i bits = classBits256(_mm256_loadu_si256((const __m256i*)rows[i]));
+			valid |= (uint32_t)accepts(_mm256_extract_epi16(bits, 0)) << i;
+			valid |= (uint32_t)accepts(_mm256_extract_epi16(bits, 8)) << (i + 1);
+		}
+		return valid;
+	}
+
+private:
+	alignas(16) uint8_t classes[16];
+	alignas(16) uint8_t classBitsLow[16];
+	alignas(16) uint8_t classBitsHigh[16];
+	alignas(16) uint8_t windowMask[16];
+	int windows;
+	int excluded;
+
+	/// <summary>
+	/// Combines the two smallest interval classes of a trichord into an index below 16
+	/// </summary>
+	/// <param name="first">The interval from the first pc to the second</param>
+	/// <param name="second">The interval from the second pc to the third</param>
+	/// <returns>The index</returns>
+	static int classIndex(int first, int second)
+	{
+		int a = std::min(first, 12 - first);
+		int b = std::min(second, 12 - second);
+		int c = (first + second) % 12;
+		c = std::min(c, 12 - c);
+		int smallest = std::min(a, std::min(b, c));
+		int middle = std::max(std::min(a, b), std::min(std::max(a, b), c));
+		return (smallest - 1) * 5 + middle - smallest;
+	}
+
+	/// <summary>
+	/// Determines if the set classes of the trichords of a row are different and allowed
+	/// </summary>
+	/// <param name="bits">The set classes of the trichords, one bit each</param>
+	/// <returns>1 if the row is valid and 0 if not</returns>
+	int accepts(int bits) const
+	{
+		return countBits((unsigned int)bits) == windows && !(bits & excluded) ? 1 : 0;
+	}
+
+	/// <summary>
+	/// Finds the set classes of the trichords of two rows, one in each 128-bit lane
+	/// </summary>
+	/// <param name="pcs">The rows</param>
+	/// <returns>The set classes of each row, one bit each, in the first 16 bits of its lane</returns>
+	BAUER_AVX2_TARGET __m256i classBits256(__m256i pcs) const
+	{
+		__m256i twelve = _mm256_set1_epi8(12);
+		__m256i one = _mm256_set1_epi8(1);
+
+		// the intervals, and the interval classes of each trichord
+		__m256i intervals = _mm256_sub_epi8(_mm256_srli_si256(pcs, 1), pcs);
+		intervals = _mm256_add_epi8(intervals, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_setzero_si256(), intervals), twelve));
+		__m256i next = _mm256_srli_si256(intervals, 1);
+		__m256i span = _mm256_add_epi8(intervals, next);
+		span = _mm256_sub_epi8(span, _mm256_and_si256(_mm256_cmpgt_epi8(span, _mm256_set1_epi8(11)), twelve));
+		__m256i a = _mm256_min_epu8(intervals, _mm256_sub_epi8(twelve, intervals));
+		__m256i b = _mm256_min_epu8(next, _mm256_sub_epi8(twelve, next));
+		__m256i c = _mm256_min_epu8(span, _mm256_sub_epi8(twelve, span));
+		__m256i smallest = _mm256_min_epu8(a, _mm256_min_epu8(b, c));
+		__m256i middle = _mm256_max_epu8(_mm256_min_epu8(a, b), _mm256_min_epu8(_mm256_max_epu8(a, b), c));
+
+		// (smallest - 1) * 5 + middle - smallest, which is 4 * (smallest - 1) + middle - 1
+		__m256i index = _mm256_sub_epi8(smallest, one);
+		index = _mm256_add_epi8(_mm256_add_epi8(index, index), _mm256_add_epi8(index, index));
+		index = _mm256_add_epi8(index, _mm256_sub_epi8(middle, one));
+		index = _mm256_and_si256(index, _mm256_set1_epi8(15));
+		__m256i found = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)classes)), index);
+
+		__m256i mask = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)windowMask));
+		__m256i low = _mm256_and_si256(_mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)classBitsLow)), found), mask);
+		__m256i high = _mm256_and_si256(_mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)classBitsHigh)), found), mask);
+
+		// OR the bits of every trichord into the first byte of each lane
+		low = _mm256_or_si256(low, _mm256_srli_si256(low, 8));
+		high = _mm256_or_si256(high, _mm256_srli_si256(high, 8));
+		low = _mm256_or_si256(low, _mm256_srli_si256(low, 4));
+		high = _mm256_or_si256(high, _mm256_srli_si256(high, 4));
+		low = _mm256_or_si256(low, _mm256_srli_si256(low, 2));
+		high = _mm256_or_si256(high, _mm256_srli_si256(high, 2));
+		low = _mm256_or_si256(low, _mm256_srli_si256(low, 1));
+		high = _mm256_or_si256(high, _mm256_srli_si256(high, 1));
+		return _mm256_or_si256(_mm256_and_si256(low, _mm256_set1_epi16(0xFF)), _mm256_slli_epi16(high, 8));
+	}
+};
+
+template <typename Sink>
+static bool extendBatchedTrichordRow(const TrichordBatchKernel& kernel, const ChordClassTable<3>& trichordTable, int excluded, int* row, int depth, int used, int trichords, const int* endPrefix, int endLength, Sink& sink);
+#endif
+template <typename Predicate, typename Sink>
+void searchTrichordRowsBatched(const ChordClassTable<3>& trichordTable, bool cyclic, int excluded, Predicate isValid, const int* endPrefix, int endLength, Sink& sink);
+
+/// <summary>
+/// Finds the rows that begin with pc 0 and lie before an end prefix, and whose imbricated
+/// trichords all have different allowed set classes. Prefixes of eight pcs are searched
+/// one pc at a time, and the orderings of the last four pcs are checked as a batch. The
+/// rows are written in lexicographic order. If the processor cannot run the AVX2 check,
+/// the rows are enumerated one at a time instead.
+/// </summary>
+/// <param name="trichordTable">The trichord table</param>
+/// <param name="cyclic">True if the trichords also wrap around from the end of the row to its beginning</param>
+/// <param name="excluded">A bitmask of the set classes that no trichord may have</param>
+/// <param name="isValid">The predicate that checks the same rows one at a time</param>
+/// <param name="endPrefix">The first prefix that is not searched</param>
+/// <param name="endLength">The number of pcs in the end prefix, no more than 8</param>
+/// <param name="sink">The sink to write the rows to</param>
+template <typename Predicate, typename Sink>
+void searchTrichordRowsBatched(const ChordClassTable<3>& trichordTable, bool cyclic, int excluded, Predicate isValid, const int* endPrefix, int endLength, Sink& sink)
+{
+#ifdef BAUER_AVX2_KERNEL
+	if (hasVectorTrichordKernel())
+	{
+		TrichordBatchKernel kernel(trichordTable, cyclic, excluded);
+		int row[12];
+		row[0] = 0;
+		extendBatchedTrichordRow(kernel, trichordTable, excluded, row, 1, 1, 0, endPrefix, endLength, sink);
+		return;
+	}
+#endif
+
+	int permutation[12];
+	for (int i = 0; i < 12; i++)
+		permutation[i] = i;
+	bool more = seekRow<12, 0>(permutation, isValid);
+	while (more && isBeforePrefix(permutation, endPrefix, endLength))
+	{
+		sink.write(permutation);
+		more = nextRow<12, 0>(permutation, isValid);
+	}
+}
+
+#ifdef BAUER_AVX2_KERNEL
+/// <summary>
+/// Tries every unused pc at one position of a prefix, and checks the rows that complete
+/// each eight-pc prefix as a batch
+/// </summary>
+/// <param name="kernel">The batch check</param>
+/// <param name="trichordTable">The trichord table</param>
+/// <param name="excluded">A bitmask of the set classes that no trichord may have</param>
+/// <param name="row">The partial row</param>
+/// <param name="depth">The position to fill</param>
+/// <param name="used">A bitmask of the pcs used so far</param>
+/// <param name="trichords">A bitmask of the set classes of the trichords so far</param>
+/// <param name="endPrefix">The first prefix that is not searched</param>
+/// <param name="endLength">The number of pcs in the end prefix</param>
+/// <param name="sink">The sink to write the rows to</param>
+/// <returns>False once the search has reached the end prefix</returns>
+template <typename Sink>
+static bool extendBatchedTrichordRow(const TrichordBatchKernel& kernel, const ChordClassTable<3>& trichordTable, int excluded, int* row, int depth, int used, int trichords, const int* endPrefix, int endLength, Sink& sink)
+{
+	// the prefixes are visited in order, so everything after the end prefix is larger
+	if (depth == endLength)
+	{
+		int compare = 0;
+		for (int i = 0; i < endLength && compare == 0; i++)
+			compare = row[i] - endPrefix[i];
+		if (compare >= 0)
+			return false;
+	}
+
+	if (depth == 8)
+	{
+		// the orderings of the remaining pcs, in lexicographic order
+		int rest[4];
+		for (int pc = 0, i = 0; pc < 12; pc++)
+		{
+			if (!(used & (1 << pc)))
+				rest[i++] = pc;
+		}
+		alignas(16) uint8_t prefix[16] = { 0 };
+		for (int i = 0; i < 8; i++)
+			prefix[i] = (uint8_t)row[i];
+		prefix[12] = (uint8_t)row[0];
+		prefix[13] = (uint8_t)row[1];
+		alignas(32) uint8_t batch[24][16];
+		int count = 0;
+		do
+		{
+			std::memcpy(batch[count], prefix, 16);
+			for (int i = 0; i < 4; i++)
+				batch[count][8 + i] = (uint8_t)rest[i];
+			count++;
+		} while (std::next_permutation(rest, rest + 4));
+
+		uint32_t valid = kernel.check(batch, count);
+		while (valid)
+		{
+			int i = lowestDigit(valid);
+			valid &= valid - 1;
+			for (int j = 8; j < 12; j++)
+				row[j] = batch[i][j];
+			sink.write(row);
+		}
+		return true;
+	}
+
+	for (int pc = 0; pc < 12; pc++)
+	{
+		if (used & (1 << pc))
+			continue;
+		row[depth] = pc;
+		int added = 0;
+		if (depth >= 2)
+		{
+			int first = row[depth - 1] - row[depth - 2];
+			if (first < 0)
+				first += 12;
+			int second = pc - row[depth - 1];
+			if (second < 0)
+				second += 12;
+			added = 1 << (trichordTable.classes[first * 12 + second] - 1);
+			if ((added & excluded) || (added & trichords))
+				continue;
+		}
+		if (!extendBatchedTrichordRow(kernel, trichordTable, excluded, row, depth + 1, used | (1 << pc), trichords | added, endPrefix, endLength, sink))
+			return false;
+	}
+	return true;
+}
+#endif
+
+#endif
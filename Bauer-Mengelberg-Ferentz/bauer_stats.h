@@ -0,0 +1,231 @@
+/*
+* File: bauer_stats.h
+* Author: Jeff Martin
+*
+* This file contains counters that show how the searches spend their time:
+* the nodes visited at each depth, the branches pruned at each failure index,
+* the leaves tested and the solutions found. They are only compiled in when
+* BAUER_INSTRUMENT is defined, so an ordinary build pays nothing for them.
+* Each thread counts into its own copy, which is added to the totals when the
+* thread finishes, and each generator writes the totals next to its output
+* as <destination>.stats.json.
+*
+* Copyright  2022 by Jeffrey Martin. All rights reserved.
+* Email: jmartin@jeffreymartincomposer.com
+* Website: https://jeffreymartincomposer.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BAUERSTATS
+#define BAUERSTATS
+
+// BAUER_COUNT(statement) runs the statement only in an instrumented build
+#ifdef BAUER_INSTRUMENT
+#define BAUER_COUNT(statement) statement
+#else
+#define BAUER_COUNT(statement)
+#endif
+
+#ifdef BAUER_INSTRUMENT
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+// the deepest search has 63 intervals, and a failure index can be one past the end
+const int STATS_DEPTHS = 65;
+
+/// <summary>
+/// The counters of a search
+/// </summary>
+struct SearchStats
+{
+	// the nodes visited at each depth. For the enumerator this is the index of the
+	// first digit that changed, and for the depth-first searches the position filled.
+	uint64_t nodes[STATS_DEPTHS];
+
+	// the branches pruned at each failure index or depth
+	uint64_t prunes[STATS_DEPTHS];
+
+	// the complete rows tested, and the ones that were valid
+	uint64_t leaves;
+	uint64_t solutions;
+
+	/// <summary>
+	/// Adds another set of counters to these
+	/// </summary>
+	/// <param name="other">The other counters</param>
+	void add(const SearchStats& other)
+	{
+		for (int i = 0; i < STATS_DEPTHS; i++)
+		{
+			nodes[i] += other.nodes[i];
+			prunes[i] += other.prunes[i];
+		}
+		leaves += other.leaves;
+		solutions += other.solutions;
+	}
+};
+
+inline void countLeaf(bool valid);
+inline void countNode(int depth);
+inline void countPrune(int depth);
+inline void countRowTest(int changed, int failedIndex);
+inline void finishSearchStats(std::string path);
+inline void mergeSearchStats();
+inline void resetSearchStats();
+inline SearchStats& threadSearchStats();
+inline SearchStats& totalSearchStats();
+inline std::mutex& totalSearchStatsLock();
+static void writeStatsArray(std::ofstream& file, const char* name, const uint64_t* counts);
+
+/// <summary>
+/// Gets the counters of the calling thread
+/// </summary>
+/// <returns>The counters</returns>
+inline SearchStats& threadSearchStats()
+{
+	thread_local SearchStats stats = {};
+	return stats;
+}
+
+/// <summary>
+/// Gets the counters added up from every thread that has finished
+/// </summary>
+/// <returns>The counters</returns>
+inline SearchStats& totalSearchStats()
+{
+	static SearchStats stats = {};
+	return stats;
+}
+
+/// <summary>
+/// Gets the lock that guards the totals
+/// </summary>
+/// <returns>The lock</returns>
+inline std::mutex& totalSearchStatsLock()
+{
+	static std::mutex lock;
+	return lock;
+}
+
+/// <summary>
+/// Counts a node of a depth-first search
+/// </summary>
+/// <param name="depth">The position filled</param>
+inline void countNode(int depth)
+{
+	threadSearchStats().nodes[depth]++;
+}
+
+/// <summary>
+/// Counts a branch of a depth-first search that was pruned
+/// </summary>
+/// <param name="depth">The position where the branch failed</param>
+inline void countPrune(int depth)
+{
+	threadSearchStats().prunes[depth]++;
+}
+
+/// <summary>
+/// Counts a complete row tested by a depth-first search
+/// </summary>
+/// <param name="valid">True if the row was valid</param>
+inline void countLeaf(bool valid)
+{
+	SearchStats& stats = threadSearchStats();
+	stats.leaves++;
+	if (valid)
+		stats.solutions++;
+}
+
+/// <summary>
+/// Counts one call of the predicate by the skip-ahead enumerator. Each call tests a
+/// complete permutation whose digits changed from an index on.
+/// </summary>
+/// <param name="changed">The index of the first digit that changed</param>
+/// <param name="failedIndex">The failure index the predicate returned, or -1</param>
+inline void countRowTest(int changed, int failedIndex)
+{
+	SearchStats& stats = threadSearchStats();
+	stats.nodes[changed]++;
+	stats.leaves++;
+	if (failedIndex == -1)
+		stats.solutions++;
+	else
+		stats.prunes[failedIndex < STATS_DEPTHS ? failedIndex : STATS_DEPTHS - 1]++;
+}
+
+/// <summary>
+/// Adds the counters of the calling thread to the totals and clears them
+/// </summary>
+inline void mergeSearchStats()
+{
+	std::lock_guard<std::mutex> guard(totalSearchStatsLock());
+	totalSearchStats().add(threadSearchStats());
+	threadSearchStats() = SearchStats();
+}
+
+/// <summary>
+/// Clears the counters of the calling thread and the totals before a search
+/// </summary>
+inline void resetSearchStats()
+{
+	std::lock_guard<std::mutex> guard(totalSearchStatsLock());
+	totalSearchStats() = SearchStats();
+	threadSearchStats() = SearchStats();
+}
+
+/// <summary>
+/// Adds the counters of the calling thread to the totals, writes the totals to a JSON
+/// file and clears them
+/// </summary>
+/// <param name="path">The file to write to</param>
+inline void finishSearchStats(std::string path)
+{
+	mergeSearchStats();
+	std::lock_guard<std::mutex> guard(totalSearchStatsLock());
+	const SearchStats& stats = totalSearchStats();
+	std::ofstream file(path);
+	file << "{\n";
+	writeStatsArray(file, "nodes", stats.nodes);
+	writeStatsArray(file, "prunes", stats.prunes);
+	file << "    \"leaves\": " << stats.leaves << ",\n";
+	file << "    \"solutions\": " << stats.solutions << "\n";
+	file << "}\n";
+	file.close();
+	totalSearchStats() = SearchStats();
+}
+
+/// <summary>
+/// Writes one array of counters, without the zeros at the end
+/// </summary>
+/// <param name="file">The file</param>
+/// <param name="name">The name of the array</param>
+/// <param name="counts">The counters, one per depth</param>
+static void writeStatsArray(std::ofstream& file, const char* name, const uint64_t* counts)
+{
+	int length = STATS_DEPTHS;
+	while (length > 0 && counts[length - 1] == 0)
+		length--;
+	file << "    \"" << name << "\": [";
+	for (int i = 0; i < length; i++)
+		file << (i > 0 ? ", " : "") << counts[i];
+	file << "],\n";
+}
+
+#endif
+
+#endif
@@ -0,0 +1,363 @@
+/*
+* File: bauer_symmetry.h
+* Author: Jeff Martin
+*
+* This file contains a canonical-form mode for the skip-ahead enumerator. The
+* rows are grouped into orbits under a group of twelve-tone operations, and
+* only the smallest row of each orbit (in lexicographic order, after
+* transposing it to begin with 0) is kept. Multiplication (I, M5 and M7) maps
+* each pc or interval on its own, so a prefix that multiplies to a smaller
+* prefix is skipped during the search together with every row that shares it.
+* Retrograde and rotation depend on the end of the row, so they are checked
+* once a row is complete. The operations must preserve the predicate, which
+* holds for every search in this program.
+*
+* Copyright  2022 by Jeffrey Martin. All rights reserved.
+* Email: jmartin@jeffreymartincomposer.com
+* Website: https://jeffreymartincomposer.com
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BAUERSYMMETRY
+#define BAUERSYMMETRY
+#include <algorithm>
+#include <vector>
+#include "bauer_engine.h"
+#include "bauer_parallel.h"
+
+// The operations that generate a symmetry group. Transposition is always included,
+// since every row is compared after transposing it to begin with 0.
+const int SYMMETRY_INVERSION = 1;
+const int SYMMETRY_M5 = 2;
+const int SYMMETRY_M7 = 4;
+const int SYMMETRY_RETROGRADE = 8;
+const int SYMMETRY_ROTATION = 16;
+const int SYMMETRY_ALL = 31;
+
+/// <summary>
+/// A group of twelve-tone operations acting on rows of pcs or on rows of intervals
+/// </summary>
+class RowSymmetryGroup
+{
+public:
+	/// <summary>
+	/// Creates the group generated by a set of operations
+	/// </summary>
+	/// <param name="symmetries">The SYMMETRY_* operations that generate the group</param>
+	/// <param name="length">The number of pcs or intervals in each row</param>
+	/// <param name="intervals">True if the rows hold intervals rather than pcs. Rotation only applies to rows of pcs.</param>
+	RowSymmetryGroup(int symmetries, int length, bool intervals) : rowLength(length), intervalRows(intervals)
+	{
+		multipliers.push_back(1);
+		if (symmetries & SYMMETRY_INVERSION)
+			multipliers.push_back(11);
+		if (symmetries & SYMMETRY_M5)
+			multipliers.push_back(5);
+		if (symmetries & SYMMETRY_M7)
+			multipliers.push_back(7);
+
+		// the units mod 12 form a group in which each element is its own inverse,
+		// so any two different multipliers bring in the third
+		for (size_t i = 1; i < multipliers.size(); i++)
+		{
+			for (size_t j = 1; j < i; j++)
+			{
+				int product = multipliers[i] * multipliers[j] % 12;
+				if (std::find(multipliers.begin(), multipliers.end(), product) == multipliers.end())
+					multipliers.push_back(product);
+			}
+		}
+		retrograde = (symmetries & SYMMETRY_RETROGRADE) != 0;
+		rotation = (symmetries & SYMMETRY_ROTATION) != 0 && !intervals;
+	}
+
+	/// <summary>
+	/// Gets the number of operations in the group, not counting transposition
+	/// </summary>
+	/// <returns>The order of the group</returns>
+	int order() const
+	{
+		return (int)multipliers.size() * (retrograde ? 2 : 1) * (rotation ? rowLength : 1);
+	}
+
+	/// <summary>
+	/// Gets the number of pcs or intervals in each row
+	/// </summary>
+	/// <returns>The length of each row</returns>
+	int length() const
+	{
+		return rowLength;
+	}
+
+	/// <summary>
+	/// Determines if the rows hold intervals rather than pcs
+	/// </summary>
+	/// <returns>True for rows of intervals</returns>
+	bool intervals() const
+	{
+		return intervalRows;
+	}
+
+	/// <summary>
+	/// Finds the first position at which a transposition or multiplication makes a prefix
+	/// smaller. Every row that shares the prefix up to that position has a smaller row in
+	/// its orbit.
+	/// </summary>
+	/// <param name="row">The row</param>
+	/// <param name="end">The number of pcs or intervals in the prefix</param>
+	/// <returns>The position, or end if no operation makes the prefix smaller</returns>
+	int prefixViolation(const int* row, int end) const
+	{
+		// a row of pcs that does not begin with 0 transposes to a smaller row
+		if (!intervalRows && end > 0 && row[0] != 0)
+			return 0;
+		int violation = end;
+		for (size_t k = 1; k < multipliers.size(); k++)
+		{
+			for (int i = 0; i < violation; i++)
+			{
+				int image = multiply(row, i, multipliers[k]);
+				if (image != row[i])
+				{
+					if (image < row[i])
+						violation = i;
+					break;
+				}
+			}
+		}
+		return violation;
+	}
+
+	/// <summary>
+	/// Determines if no retrograde or rotation of a complete row is smaller than the row.
+	/// Multiplication on its own is checked by prefixViolation.
+	/// </summary>
+	/// <param name="row">The row</param>
+	/// <returns>True if the row is the smallest row in its orbit</returns>
+	bool isCanonical(const int* row) const
+	{
+		int image[64];
+		for (int r = 0; r < (rotation ? rowLength : 1); r++)
+		{
+			for (int backward = 0; backward < (retrograde ? 2 : 1); backward++)
+			{
+				if (r == 0 && backward == 0)
+					continue;
+				for (size_t k = 0; k < multipliers.size(); k++)
+				{
+					transform(row, multipliers[k], backward != 0, r, image);
+					if (std::lexicographical_compare(image, image + rowLength, row, row + rowLength))
+						return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Finds every distinct row in the orbit of a row
+	/// </summary>
+	/// <param name="row">The row</param>
+	/// <param name="orbit">The rows of the orbit in lexicographic order, stored one after another</param>
+	void expand(const int* row, std::vector<int>& orbit) const
+	{
+		std::vector<std::vector<int>> images;
+		std::vector<int> image(rowLength);
+		for (int r = 0; r < (rotation ? rowLength : 1); r++)
+		{
+			for (int backward = 0; backward < (retrograde ? 2 : 1); backward++)
+			{
+				for (size_t k = 0; k < multipliers.size(); k++)
+				{
+					transform(row, multipliers[k], backward != 0, r, image.data());
+					images.push_back(image);
+				}
+			}
+		}
+		std::sort(images.begin(), images.end());
+		images.erase(std::unique(images.begin(), images.end()), images.end());
+		orbit.clear();
+		for (size_t i = 0; i < images.size(); i++)
+			orbit.insert(orbit.end(), images[i].begin(), images[i].end());
+	}
+
+private:
+	std::vector<int> multipliers;
+	int rowLength;
+	bool intervalRows;
+	bool retrograde;
+	bool rotation;
+
+	/// <summary>
+	/// Multiplies one pc or interval of a row, after transposing the row to begin with 0
+	/// </summary>
+	/// <param name="row">The row</param>
+	/// <param name="i">The position</param>
+	/// <param name="multiplier">The multiplier</param>
+	/// <returns>The product mod 12</returns>
+	int multiply(const int* row, int i, int multiplier) const
+	{
+		int value = intervalRows ? row[i] : row[i] - row[0] + 12;
+		return value * multiplier % 12;
+	}
+
+	/// <summary>
+	/// Applies rotation, then retrograde, then multiplication to a row, and transposes
+	/// the result to begin with 0
+	/// </summary>
+	/// <param name="row">The row</param>
+	/// <param name="multiplier">The multiplier</param>
+	/// <param name="backward">True to take the retrograde</param>
+	/// <param name="shift">The number of positions to rotate left by</param>
+	/// <param name="image">The transformed row</param>
+	void transform(const int* row, int multiplier, bool backward, int shift, int* image) const
+	{
+		for (int i = 0; i < rowLength; i++)
+		{
+			int j = backward ? rowLength - 1 - i : i;
+			if (intervalRows)
+			{
+				// the retrograde of a row runs through its intervals backward and inverted
+				int interval = backward ? 12 - row[j] : row[j];
+				image[i] = interval * multiplier % 12;
+			}
+			else
+				image[i] = row[(j + shift) % rowLength];
+		}
+		if (!intervalRows)
+		{
+			int first = image[0];
+			for (int i = 0; i < rowLength; i++)
+				image[i] = (image[i] - first + 12) * multiplier % 12;
+		}
+	}
+};
+
+/// <summary>
+/// Wraps a validity predicate so that it only accepts the smallest row of each orbit
+/// under a symmetry group. A prefix is rejected as soon as the predicate or a
+/// multiplication rejects it.
+/// </summary>
+template <typename Predicate>
+struct CanonicalPredicate
+{
+	Predicate isValid;
+	const RowSymmetryGroup* group;
+
+	CanonicalPredicate(const Predicate& isValid, const RowSymmetryGroup& group) : isValid(isValid), group(&group) {}
+
+	/// <summary>
+	/// Determines if a row is valid and canonical
+	/// </summary>
+	/// <param name="permutation">The row</param>
+	/// <param name="from">The index of the first pc or interval that changed since the last call</param>
+	/// <returns>The index that failed, or -1 if the row is valid and canonical</returns>
+	int operator()(int* permutation, int from)
+	{
+		int length = group->length();
+		int failed = isValid(permutation, from);
+		int end = failed == -1 || failed >= length ? length : failed + 1;
+		int violation = group->prefixViolation(permutation, end);
+		if (violation < end)
+			return violation;
+		if (failed != -1)
+			return failed;
+
+		// skip only this row if a retrograde or rotation of it is smaller
+		return group->isCanonical(permutation) ? -1 : length;
+	}
+};
+
+/// <summary>
+/// A sink that writes every row of the orbit of each row it is given
+/// </summary>
+template <typename Sink>
+class OrbitWriter
+{
+public:
+	OrbitWriter(const RowSymmetryGroup& group, Sink& sink) : group(group), sink(sink) {}
+
+	/// <summary>
+	/// Writes the rows of an orbit in lexicographic order
+	/// </summary>
+	/// <param name="row">A row of the orbit</param>
+	void write(const int* row)
+	{
+		group.expand(row, orbit);
+		for (size_t i = 0; i < orbit.size(); i += group.length())
+			sink.write(&orbit[i]);
+	}
+
+private:
+	const RowSymmetryGroup& group;
+	Sink& sink;
+	std::vector<int> orbit;
+};
+
+/// <summary>
+/// Finds the smallest valid row of each orbit under a symmetry group. Rows of pcs are
+/// searched among the rows that begin with First, and rows of intervals among all permutations.
+/// </summary>
+/// <typeparam name="Length">The number of digits in the permutation</typeparam>
+/// <typeparam name="First">The smallest digit in the permutation</typeparam>
+/// <param name="isValid">The validity predicate, which the group must preserve</param>
+/// <param name="group">The symmetry group</param>
+/// <param name="threads">The number of threads to search with, or 0 to use every hardware thread</param>
+/// <param name="sink">The sink to write the rows to</param>
+template <int Length, int First, typename Predicate, typename Sink>
+void searchCanonical(const Predicate& isValid, const RowSymmetryGroup& group, unsigned int threads, Sink& sink)
+{
+	CanonicalPredicate<Predicate> isCanonical(isValid, group);
+	const int endPrefix[1] = { group.intervals() ? First + Length : First + 1 };
+	if (threads != 1)
+		searchParallel<Length, First>(isCanonical, endPrefix, 1, threads, sink);
+	else
+	{
+		int permutation[Length];
+		for (int i = 0; i < Length; i++)
+			permutation[i] = First + i;
+		bool more = seekRow<Length, First>(permutation, isCanonical);
+		while (more && permutation[0] < endPrefix[0])
+		{
+			sink.write(permutation);
+			more = nextRow<Length, First>(permutation, isCanonical);
+		}
+	}
+}
+
+/// <summary>
+/// Finds the smallest valid row of each orbit under a symmetry group, and writes either
+/// those rows or every row of their orbits
+/// </summary>
+/// <typeparam name="Length">The number of digits in the permutation</typeparam>
+/// <typeparam name="First">The smallest digit in the permutation</typeparam>
+/// <param name="isValid">The validity predicate, which the group must preserve</param>
+/// <param name="group">The symmetry group</param>
+/// <param name="expandOrbits">True to write every row of each orbit, orbit by orbit</param>
+/// <param name="threads">The number of threads to search with, or 0 to use every hardware thread</param>
+/// <param name="sink">The sink to write the rows to</param>
+template <int Length, int First, typename Predicate, typename Sink>
+void searchOrbits(const Predicate& isValid, const RowSymmetryGroup& group, bool expandOrbits, unsigned int threads, Sink& sink)
+{
+	if (expandOrbits)
+	{
+		OrbitWriter<Sink> orbits(group, sink);
+		searchCanonical<Length, First>(isValid, group, threads, orbits);
+	}
+	else
+		searchCanonical<Length, First>(isValid, group, threads, sink);
+}
+
+#endif
@@ -29,49 +29,213 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include "bauer_arena.h"
+#include "bauer_binary.h"
+#include "bauer_engine.h"
+#include "bauer_halfrow.h"
+#include "bauer_parallel.h"
+#include "bauer_setclass.h"
+#include "bauer_shard.h"
+#include "bauer_simd.h"
+#include "bauer_symmetry.h"
 
-void generateAllTrichordRows(std::string destinationFile);
+uint64_t countAllTrichordRows(unsigned int threads = 1);
+void generateAllTrichordRows(std::string destinationFile, unsigned int threads = 1, bool resume = false, SearchShard shard = WHOLE_SEARCH);
+void generateAllTrichordRowsBatched(std::string destinationFile);
+void generateAllTrichordRowsByJoin(std::string destinationFile);
+void generateCanonicalAllTrichordRows(std::string destinationFile, int symmetries, bool expandOrbits, unsigned int threads = 1);
 int isValidTrichordRow(int* permutation, int trichordTable[12][12]);
 void loadIntervalTable(int table[12][12]);
-void nextTrichordRow(int* permutation, int trichordTable[12][12]);
-void writeTrichordRowsToFile(std::string path, std::vector<int*> found);
+void nextTrichordRow(int* permutation);
+void writeTrichordRowsToFile(std::string path, const RowArena& found);
+
+/// <summary>
+/// An incremental version of isValidTrichordRow. It remembers the intervals of the last
+/// row it checked and the trichords seen before each imbricated trichord, so only the
+/// trichords that touch the changed suffix are looked up again.
+/// </summary>
+struct TrichordRowPredicate
+{
+	const ChordClassTable<3>* trichordTable;
+
+	// the intervals of the row, and the bitmask of trichords seen before each trichord
+	int intervals[12];
+	int seen[13];
+
+	// the number of intervals and trichord bitmasks above that are current
+	int measured;
+	int checked;
+
+	TrichordRowPredicate(const ChordClassTable<3>& trichordTable) : trichordTable(&trichordTable), measured(0), checked(0)
+	{
+		seen[0] = 0;
+	}
+
+	/// <summary>
+	/// Determines if a twelve-tone row is an all-trichord row
+	/// </summary>
+	/// <param name="permutation">A twelve-tone row</param>
+	/// <param name="from">The index of the first pc that changed since the last call</param>
+	/// <returns>The index of the pc that failed, or -1 if the row is an all-trichord row</returns>
+	int operator()(int* permutation, int from)
+	{
+		// interval i spans pcs i and i + 1, and trichord i spans pcs i through i + 2
+		if (from - 1 < measured)
+			measured = from > 1 ? from - 1 : 0;
+		for (int i = measured; i < 12; i++)
+		{
+			intervals[i] = permutation[(i + 1) % 12] - permutation[i];
+			if (intervals[i] < 0)
+				intervals[i] += 12;
+		}
+		measured = 12;
+		if (from - 2 < checked)
+			checked = from > 2 ? from - 2 : 0;
+
+		for (int i = checked; i < 12; i++)
+		{
+			int idx = trichordTable->classes[intervals[i] * 12 + intervals[(i + 1) % 12]] - 1;
+			if (seen[i] & (1 << idx))
+			{
+				checked = i;
+				return i < 10 ? i + 2 : 12;
+			}
+			seen[i + 1] = seen[i] | (1 << idx);
+		}
+		checked = 12;
+		return -1;
+	}
+};
 
 /// <summary>
 /// Generates the all-trichord rows
 /// </summary>
-void generateAllTrichordRows(std::string destinationFile)
+/// <param name="destinationFile">The destination file, in binary if it ends in .bin and in JSON otherwise</param>
+/// <param name="threads">The number of threads to search with, or 0 to use every hardware thread</param>
+/// <param name="resume">True to carry on from the last checkpoint of an unfinished search, if there is one</param>
+/// <param name="shard">The shard of the search to run</param>
+void generateAllTrichordRows(std::string destinationFile, unsigned int threads, bool resume, SearchShard shard)
 {
-	int permutation[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
-	std::vector<int*> found;
-	int trichordTable[12][12];
-	bool finished = false;
-	loadIntervalTable(trichordTable);
+	int permutation[12];
 
-	std::cout << "Starting...\n";
-	nextTrichordRow(permutation, trichordTable);
+	BAUER_COUNT(resetSearchStats());
+
+	// the part of the search this shard covers. There are no rows that begin with 06...,
+	// so the whole search ends at 06...
+	const int endPrefix[2] = { 0, 6 };
+	int shardEnd[12];
+	int shardEndLength = findShardRange<12, 0>(shard, endPrefix, 2, permutation, shardEnd);
 
-	// consider each possible permutation. There are no permutations that begin with 06...,
-	// so we can just stop once the second digit is greater than 5.
-	while (permutation[1] < 6)
+	// carry on from the last checkpoint if asked to
+	SearchCheckpoint checkpoint(destinationFile + ".checkpoint", shardSearchName("allTrichordRows", shard), 12);
+	bool resumed = resume && checkpoint.load(permutation);
+	RowFileWriter writer(destinationFile, "allTrichordRows", 12, 12, checkpoint.output());
+	checkpoint.attach(writer);
+
+	std::cout << (resumed ? "Resuming...\n" : "Starting...\n");
+	if (threads != 1)
 	{
-		// add the new generator to the array
-		int* newFound = new int[12];
-		for (int i = 0; i < 12; i++)
-			newFound[i] = permutation[i];
-		found.push_back(newFound);
-
-		// move to the next permutation
-		nextTrichordRow(permutation, trichordTable);
+		searchParallel<12, 0>(TrichordRowPredicate(TRICHORD_TABLE), shardEnd, shardEndLength, threads, writer, permutation, &checkpoint);
 	}
+	else
+	{
+		// look at the starting permutation too, since it may be a checkpoint
+		CheckpointPredicate<TrichordRowPredicate> isValid(TrichordRowPredicate(TRICHORD_TABLE), checkpoint);
+		seekRow<12, 0>(permutation, isValid);
+
+		// consider each possible permutation up to the end of the shard
+		while (isBeforePrefix(permutation, shardEnd, shardEndLength))
+		{
+			// write the new generator to the file
+			writer.write(permutation);
+
+			// move to the next permutation
+			nextRow<12, 0>(permutation, isValid);
+		}
+	}
+
+	// finish the file
+	writer.close();
+	checkpoint.finish();
+	BAUER_COUNT(finishSearchStats(destinationFile + ".stats.json"));
+
+	std::cout << "Done. Found " << writer.count() << " row generators.\n";
+}
+
+/// <summary>
+/// Counts the all-trichord rows without storing or writing them
+/// </summary>
+/// <param name="threads">The number of threads to search with, or 0 to use every hardware thread</param>
+/// <returns>The number of rows</returns>
+uint64_t countAllTrichordRows(unsigned int threads)
+{
+	const int endPrefix[2] = { 0, 6 };
+	RowCounter counter;
+	searchParallel<12, 0>(TrichordRowPredicate(TRICHORD_TABLE), endPrefix, 2, threads, counter);
+	return counter.count();
+}
+
+/// <summary>
+/// Generates the all-trichord rows by joining half rows
+/// </summary>
+/// <param name="destinationFile">The destination file, in binary if it ends in .bin and in JSON otherwise</param>
+void generateAllTrichordRowsByJoin(std::string destinationFile)
+{
+	RowFileWriter writer(destinationFile, "allTrichordRows", 12, 12);
+
+	std::cout << "Starting...\n";
+	// there are no rows that begin with 06..., so the search ends at 06...
+	const int endPrefix[2] = { 0, 6 };
+	HalfRowIndex index(TRICHORD_TABLE, 0);
+	joinTrichordHalfRows(index, true, endPrefix, 2, writer);
 
-	// export the row generators
-	writeTrichordRowsToFile(destinationFile, found);
+	// finish the file
+	writer.close();
 
-	// cleanup
-	for (int i = 0; i < found.size(); i++)
-		delete[] found[i];
+	std::cout << "Done. Found " << writer.count() << " rows.\n";
+}
+
+/// <summary>
+/// Generates the all-trichord rows, checking the last four pcs of each row in batches
+/// </summary>
+/// <param name="destinationFile">The destination file, in binary if it ends in .bin and in JSON otherwise</param>
+void generateAllTrichordRowsBatched(std::string destinationFile)
+{
+	RowFileWriter writer(destinationFile, "allTrichordRows", 12, 12);
+
+	std::cout << "Starting...\n";
+	// there are no rows that begin with 06..., so the search ends at 06...
+	const int endPrefix[2] = { 0, 6 };
+	searchTrichordRowsBatched(TRICHORD_TABLE, true, 0, TrichordRowPredicate(TRICHORD_TABLE), endPrefix, 2, writer);
+
+	// finish the file
+	writer.close();
+
+	std::cout << "Done. Found " << writer.count() << " rows.\n";
+}
+
+/// <summary>
+/// Generates one all-trichord row from each orbit under a symmetry group. The rows
+/// are cyclic, so rotation can be part of the group.
+/// </summary>
+/// <param name="destinationFile">The destination file, in binary if it ends in .bin and in JSON otherwise</param>
+/// <param name="symmetries">The SYMMETRY_* operations that generate the group</param>
+/// <param name="expandOrbits">True to write every row of each orbit instead of one</param>
+/// <param name="threads">The number of threads to search with, or 0 to use every hardware thread</param>
+void generateCanonicalAllTrichordRows(std::string destinationFile, int symmetries, bool expandOrbits, unsigned int threads)
+{
+	RowFileWriter writer(destinationFile, "allTrichordRows", 12, 12);
+	RowSymmetryGroup group(symmetries, 12, false);
+
+	std::cout << "Starting...\n";
+	BAUER_COUNT(resetSearchStats());
+	searchOrbits<12, 0>(TrichordRowPredicate(TRICHORD_TABLE), group, expandOrbits, threads, writer);
+
+	// finish the file
+	writer.close();
+	BAUER_COUNT(finishSearchStats(destinationFile + ".stats.json"));
 
-	std::cout << "Done. Found " << found.size() << " row generators.\n";
+	std::cout << "Done. Found " << writer.count() << " rows.\n";
 }
 
 /// <summary>
@@ -111,249 +275,41 @@ int isValidTrichordRow(int* permutation, int trichordTable[12][12])
 }
 
 /// <summary>
-/// Loads a table of trichord spacing intervals
+/// Loads a table of trichord spacing intervals for isValidTrichordRow and its variants.
+/// The table is copied from the one built at compile time in bauer_setclass.h, which the
+/// searches read directly, and entries for repeated pcs are 0.
 /// </summary>
 /// <param name="table">A 2D array of size 12x12</param>
 void loadIntervalTable(int table[12][12])
 {
-	table[2][11] = 1;
-	table[11][2] = 1;
-	table[1][10] = 1;
-	table[11][11] = 1;
-	table[1][1] = 1;
-	table[10][1] = 1;
-	table[3][11] = 2;
-	table[3][10] = 2;
-	table[10][3] = 2;
-	table[2][9] = 2;
-	table[1][9] = 2;
-	table[11][10] = 2;
-	table[10][11] = 2;
-	table[9][2] = 2;
-	table[2][1] = 2;
-	table[11][3] = 2;
-	table[9][1] = 2;
-	table[1][2] = 2;
-	table[3][8] = 3;
-	table[11][4] = 3;
-	table[8][1] = 3;
-	table[9][4] = 3;
-	table[4][9] = 3;
-	table[3][1] = 3;
-	table[4][11] = 3;
-	table[11][9] = 3;
-	table[1][8] = 3;
-	table[8][3] = 3;
-	table[9][11] = 3;
-	table[1][3] = 3;
-	table[8][5] = 4;
-	table[11][8] = 4;
-	table[8][11] = 4;
-	table[1][4] = 4;
-	table[4][7] = 4;
-	table[1][7] = 4;
-	table[7][1] = 4;
-	table[5][8] = 4;
-	table[7][4] = 4;
-	table[5][11] = 4;
-	table[4][1] = 4;
-	table[11][5] = 4;
-	table[6][7] = 5;
-	table[7][11] = 5;
-	table[6][11] = 5;
-	table[5][1] = 5;
-	table[7][6] = 5;
-	table[1][6] = 5;
-	table[1][5] = 5;
-	table[5][6] = 5;
-	table[11][7] = 5;
-	table[11][6] = 5;
-	table[6][1] = 5;
-	table[6][5] = 5;
-	table[4][10] = 6;
-	table[2][2] = 6;
-	table[10][10] = 6;
-	table[8][2] = 6;
-	table[2][8] = 6;
-	table[10][4] = 6;
-	table[7][2] = 7;
-	table[3][7] = 7;
-	table[10][9] = 7;
-	table[2][7] = 7;
-	table[2][3] = 7;
-	table[3][2] = 7;
-	table[9][10] = 7;
-	table[5][10] = 7;
-	table[9][5] = 7;
-	table[10][5] = 7;
-	table[5][9] = 7;
-	table[7][3] = 7;
-	table[8][6] = 8;
-	table[4][6] = 8;
-	table[6][2] = 8;
-	table[6][4] = 8;
-	table[4][2] = 8;
-	table[6][8] = 8;
-	table[8][10] = 8;
-	table[2][4] = 8;
-	table[10][8] = 8;
-	table[2][6] = 8;
-	table[10][6] = 8;
-	table[6][10] = 8;
-	table[7][10] = 9;
-	table[2][5] = 9;
-	table[5][2] = 9;
-	table[5][5] = 9;
-	table[10][7] = 9;
-	table[7][7] = 9;
-	table[3][6] = 10;
-	table[3][3] = 10;
-	table[6][9] = 10;
-	table[9][9] = 10;
-	table[6][3] = 10;
-	table[9][6] = 10;
-	table[9][7] = 11;
-	table[3][5] = 11;
-	table[8][7] = 11;
-	table[3][4] = 11;
-	table[4][3] = 11;
-	table[4][5] = 11;
-	table[7][8] = 11;
-	table[8][9] = 11;
-	table[9][8] = 11;
-	table[5][3] = 11;
-	table[7][9] = 11;
-	table[5][4] = 11;
-	table[8][8] = 12;
-	table[4][4] = 12;
+	for (int first = 0; first < 12; first++)
+	{
+		for (int second = 0; second < 12; second++)
+			table[first][second] = trichordClass(first, second);
+	}
 }
 
 /// <summary>
 /// Updates the row to the next valid all-trichord row
 /// </summary>
 /// <param name="permutation">The row</param>
-/// <param name="trichordTable">A table of spacing intervals for the twelve trichords</param>
-void nextTrichordRow(int* permutation, int trichordTable[12][12])
+void nextTrichordRow(int* permutation)
 {
-	// assume that the permutation is valid
-	int validPermutation = -1;
-
-	do
-	{
-		int criticalIndex = validPermutation;
-		int smallestRight = 0;
-		int buffer[12] = { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
-		buffer[permutation[11]] = permutation[11];
-
-		// if we don't have a critical index already, we need to find it
-		if (criticalIndex == -1 || criticalIndex > 11)
-		{
-			// Identify the index of the critical digit, as well as the smallest number
-			// Critical digit cannot be the last digit; must be index 10 or lower
-			for (int i = 10; i >= 0; i--)
-			{
-				buffer[permutation[i]] = permutation[i];
-
-				// if we have identified the critical digit
-				if (permutation[i] < permutation[i + 1])
-				{
-					smallestRight = permutation[i] + 1;
-					criticalIndex = i;
-					while (buffer[smallestRight] == -1)
-						smallestRight++;
-					permutation[i] = smallestRight;
-					buffer[smallestRight] = -1;
-					break;
-				}
-			}
-		}
-
-		// If the critical index was provided
-		else
-		{
-			for (int i = 10; i >= criticalIndex; i--)
-				buffer[permutation[i]] = permutation[i];
-			smallestRight = permutation[criticalIndex] + 1;
-			// If the critical digit is not 11, search for the smallest right
-			// digit that is larger than the critical digit
-			if (smallestRight < 12)
-			{
-				while (buffer[smallestRight] == -1)
-				{
-					smallestRight++;
-					if (smallestRight > 11)
-						break;
-				}
-			}
-			// If we were unable to find an acceptable smallest right digit,
-			// we need to find a new critical digit.
-			if (smallestRight > 11)
-			{
-				// Identify the index of the critical digit, as well as the smallest number
-				// Critical digit cannot be the last digit; must be index 10 or lower
-				for (int i = criticalIndex - 1; i >= 0; i--)
-				{
-					buffer[permutation[i]] = permutation[i];
-
-					// if we have identified the critical digit
-					if (permutation[i] < permutation[i + 1])
-					{
-						smallestRight = permutation[i] + 1;
-						criticalIndex = i;
-						while (buffer[smallestRight] == -1)
-							smallestRight++;
-						permutation[i] = smallestRight;
-						buffer[smallestRight] = -1;
-						break;
-					}
-				}
-			}
-			else
-			{
-				permutation[criticalIndex] = smallestRight;
-				buffer[smallestRight] = -1;
-			}
-		}
-
-		// Update the permutation and reset the buffer
-		smallestRight = 0;
-		for (int i = criticalIndex + 1; i < 12; i++)
-		{
-			while (buffer[smallestRight] == -1)
-				smallestRight++;
-			permutation[i] = smallestRight;
-			smallestRight++;
-		}
-		validPermutation = isValidTrichordRow(permutation, trichordTable);
-	} while (validPermutation > -1);
+	TrichordRowPredicate isValid(TRICHORD_TABLE);
+	nextRow<12, 0>(permutation, isValid);
 }
 
 /// <summary>
 /// Writes found all-trichord rows to file
 /// </summary>
 /// <param name="path">The file to write to</param>
-/// <param name="found">A vector of found rows</param>
-void writeTrichordRowsToFile(std::string path, std::vector<int*> found)
+/// <param name="found">An arena of found rows</param>
+void writeTrichordRowsToFile(std::string path, const RowArena& found)
 {
-	std::ofstream file;
-	file.open(path);
-	file << "{\n    \"allTrichordRows\": [\n";
-	for (int i = 0; i < found.size() - 1; i++)
-	{
-		file << "        [";
-		for (int j = 0; j < 11; j++)
-			file << found[i][j] << ", ";
-		file << found[i][11] << "],\n";
-	}
-	if (found.size() > 0)
-	{
-		file << "        [";
-		for (int j = 0; j < 11; j++)
-			file << found[found.size() - 1][j] << ", ";
-		file << found[found.size() - 1][11] << "]\n";
-	}
-	file << "    ]\n}\n";
-	file.close();
+	JsonRowWriter writer(path, "allTrichordRows", found.length());
+	for (size_t i = 0; i < found.size(); i++)
+		writer.write(found[i]);
+	writer.close();
 }
 
 #endif
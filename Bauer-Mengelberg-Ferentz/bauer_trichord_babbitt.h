@@ -33,47 +33,184 @@
 #include <vector>
 #include "bauer_trichord.h"
 
-void generateBabbittAllTrichordRows(std::string destinationFile);
+uint64_t countBabbittAllTrichordRows(unsigned int threads = 1);
+void generateCanonicalBabbittAllTrichordRows(std::string destinationFile, int symmetries, bool expandOrbits, unsigned int threads = 1);
+void generateBabbittAllTrichordRows(std::string destinationFile, unsigned int threads = 1, bool resume = false, SearchShard shard = WHOLE_SEARCH);
+void generateBabbittAllTrichordRowsByJoin(std::string destinationFile);
 int isValidBabbittTrichordRow(int* permutation, int trichordTable[12][12]);
-void nextBabbittTrichordRow(int* permutation, int trichordTable[12][12]);
-void writeBabbittTrichordRowsToFile(std::string path, std::vector<int*> found);
+void nextBabbittTrichordRow(int* permutation);
+void writeBabbittTrichordRowsToFile(std::string path, const RowArena& found);
+
+/// <summary>
+/// An incremental version of isValidBabbittTrichordRow. It remembers the intervals of
+/// the last row it checked and the trichords seen before each imbricated trichord, so
+/// only the trichords that touch the changed suffix are looked up again.
+/// </summary>
+struct BabbittTrichordRowPredicate
+{
+	const ChordClassTable<3>* trichordTable;
+
+	// the intervals of the row, and the bitmask of trichords seen before each trichord
+	int intervals[11];
+	int seen[11];
+
+	// the number of intervals and trichord bitmasks above that are current
+	int measured;
+	int checked;
+
+	BabbittTrichordRowPredicate(const ChordClassTable<3>& trichordTable) : trichordTable(&trichordTable), measured(0), checked(0)
+	{
+		seen[0] = 0;
+	}
+
+	/// <summary>
+	/// Determines if a twelve-tone row is a Babbitt all-trichord row
+	/// </summary>
+	/// <param name="permutation">A twelve-tone row</param>
+	/// <param name="from">The index of the first pc that changed since the last call</param>
+	/// <returns>The index of the pc that failed, or -1 if the row is a Babbitt all-trichord row</returns>
+	int operator()(int* permutation, int from)
+	{
+		// interval i spans pcs i and i + 1, and trichord i spans pcs i through i + 2
+		if (from - 1 < measured)
+			measured = from > 1 ? from - 1 : 0;
+		for (int i = measured; i < 11; i++)
+		{
+			intervals[i] = permutation[i + 1] - permutation[i];
+			if (intervals[i] < 0)
+				intervals[i] += 12;
+		}
+		measured = 11;
+		if (from - 2 < checked)
+			checked = from > 2 ? from - 2 : 0;
+
+		for (int i = checked; i < 10; i++)
+		{
+			int idx = trichordTable->classes[intervals[i] * 12 + intervals[i + 1]] - 1;
+			// we can't allow set-classes [036] and [048], or duplicate trichords
+			if (idx == 9 || idx == 11 || (seen[i] & (1 << idx)))
+			{
+				checked = i;
+				return i + 2;
+			}
+			seen[i + 1] = seen[i] | (1 << idx);
+		}
+		checked = 10;
+		return -1;
+	}
+};
 
 /// <summary>
 /// Generates the Babbitt all-trichord rows
 /// </summary>
-void generateBabbittAllTrichordRows(std::string destinationFile)
+/// <param name="destinationFile">The destination file, in binary if it ends in .bin and in JSON otherwise</param>
+/// <param name="threads">The number of threads to search with, or 0 to use every hardware thread</param>
+/// <param name="resume">True to carry on from the last checkpoint of an unfinished search, if there is one</param>
+/// <param name="shard">The shard of the search to run</param>
+void generateBabbittAllTrichordRows(std::string destinationFile, unsigned int threads, bool resume, SearchShard shard)
 {
-	int permutation[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
-	std::vector<int*> found;
-	int trichordTable[12][12];
-	bool finished = false;
-	loadIntervalTable(trichordTable);
+	int permutation[12];
 
-	std::cout << "Starting...\n";
-	nextBabbittTrichordRow(permutation, trichordTable);
+	BAUER_COUNT(resetSearchStats());
+
+	// the part of the search this shard covers. The whole search ends after 065...,
+	// since no permutations begin with 066...
+	const int endPrefix[3] = { 0, 6, 7 };
+	int shardEnd[12];
+	int shardEndLength = findShardRange<12, 0>(shard, endPrefix, 3, permutation, shardEnd);
+
+	// carry on from the last checkpoint if asked to
+	SearchCheckpoint checkpoint(destinationFile + ".checkpoint", shardSearchName("allTrichordBabbittRows", shard), 12);
+	bool resumed = resume && checkpoint.load(permutation);
+	RowFileWriter writer(destinationFile, "allTrichordBabbittRows", 12, 12, checkpoint.output());
+	checkpoint.attach(writer);
 
-	// consider each possible permutation up to 065...
-	// no permutations begin with 066... so we stop there
-	while (permutation[1] < 6 || permutation[2] < 6)
+	std::cout << (resumed ? "Resuming...\n" : "Starting...\n");
+	if (threads != 1)
 	{
-		// add the new generator to the array
-		int* newFound = new int[12];
-		for (int i = 0; i < 12; i++)
-			newFound[i] = permutation[i];
-		found.push_back(newFound);
-
-		// move to the next permutation
-		nextBabbittTrichordRow(permutation, trichordTable);
+		searchParallel<12, 0>(BabbittTrichordRowPredicate(TRICHORD_TABLE), shardEnd, shardEndLength, threads, writer, permutation, &checkpoint);
 	}
+	else
+	{
+		// look at the starting permutation too, since it may be a checkpoint
+		CheckpointPredicate<BabbittTrichordRowPredicate> isValid(BabbittTrichordRowPredicate(TRICHORD_TABLE), checkpoint);
+		seekRow<12, 0>(permutation, isValid);
+
+		// consider each possible permutation up to the end of the shard
+		while (isBeforePrefix(permutation, shardEnd, shardEndLength))
+		{
+			// write the new generator to the file
+			writer.write(permutation);
+
+			// move to the next permutation
+			nextRow<12, 0>(permutation, isValid);
+		}
+	}
+
+	// finish the file
+	writer.close();
+	checkpoint.finish();
+	BAUER_COUNT(finishSearchStats(destinationFile + ".stats.json"));
+
+	std::cout << "Done. Found " << writer.count() << " row generators.\n";
+}
+
+/// <summary>
+/// Counts the Babbitt all-trichord rows without storing or writing them
+/// </summary>
+/// <param name="threads">The number of threads to search with, or 0 to use every hardware thread</param>
+/// <returns>The number of rows</returns>
+uint64_t countBabbittAllTrichordRows(unsigned int threads)
+{
+	const int endPrefix[3] = { 0, 6, 7 };
+	RowCounter counter;
+	searchParallel<12, 0>(BabbittTrichordRowPredicate(TRICHORD_TABLE), endPrefix, 3, threads, counter);
+	return counter.count();
+}
 
-	// export the row generators
-	writeBabbittTrichordRowsToFile(destinationFile, found);
+/// <summary>
+/// Generates the all-trichord Babbitt rows by joining half rows
+/// </summary>
+/// <param name="destinationFile">The destination file, in binary if it ends in .bin and in JSON otherwise</param>
+void generateBabbittAllTrichordRowsByJoin(std::string destinationFile)
+{
+	RowFileWriter writer(destinationFile, "allTrichordBabbittRows", 12, 12);
+
+	std::cout << "Starting...\n";
+	// the same range as the enumerator, which ends at 067..., without 036 and 048
+	const int endPrefix[3] = { 0, 6, 7 };
+	HalfRowIndex index(TRICHORD_TABLE, (1 << 9) | (1 << 11));
+	joinTrichordHalfRows(index, false, endPrefix, 3, writer);
 
-	// cleanup
-	for (int i = 0; i < found.size(); i++)
-		delete[] found[i];
+	// finish the file
+	writer.close();
 
-	std::cout << "Done. Found " << found.size() << " row generators.\n";
+	std::cout << "Done. Found " << writer.count() << " rows.\n";
+}
+
+/// <summary>
+/// Generates one all-trichord Babbitt row from each orbit under a symmetry group. The
+/// rows are not cyclic, so rotation is left out of the group. M5 and M7 map 036 and 048
+/// to themselves, so they preserve the excluded trichords.
+/// </summary>
+/// <param name="destinationFile">The destination file, in binary if it ends in .bin and in JSON otherwise</param>
+/// <param name="symmetries">The SYMMETRY_* operations that generate the group</param>
+/// <param name="expandOrbits">True to write every row of each orbit instead of one</param>
+/// <param name="threads">The number of threads to search with, or 0 to use every hardware thread</param>
+void generateCanonicalBabbittAllTrichordRows(std::string destinationFile, int symmetries, bool expandOrbits, unsigned int threads)
+{
+	RowFileWriter writer(destinationFile, "allTrichordBabbittRows", 12, 12);
+	RowSymmetryGroup group(symmetries & ~SYMMETRY_ROTATION, 12, false);
+
+	std::cout << "Starting...\n";
+	BAUER_COUNT(resetSearchStats());
+	searchOrbits<12, 0>(BabbittTrichordRowPredicate(TRICHORD_TABLE), group, expandOrbits, threads, writer);
+
+	// finish the file
+	writer.close();
+	BAUER_COUNT(finishSearchStats(destinationFile + ".stats.json"));
+
+	std::cout << "Done. Found " << writer.count() << " rows.\n";
 }
 
 /// <summary>
@@ -81,7 +218,7 @@ void generateBabbittAllTrichordRows(std::string destinationFile)
 /// </summary>
 /// <param name="permutation">A twelve-tone row</param>
 /// <returns>The index of the pc that failed, or -1 if the row is a Babbitt all-trichord row</returns>
-static int isValidBabbittTrichordRow(int* permutation, int trichordTable[12][12])
+int isValidBabbittTrichordRow(int* permutation, int trichordTable[12][12])
 {
 	int trichords[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
 
@@ -125,128 +262,23 @@ static int isValidBabbittTrichordRow(int* permutation, int trichordTable[12][12]
 /// Updates the twelve-tone row to the next valid Babbitt all-trichord row
 /// </summary>
 /// <param name="permutation">The permutation</param>
-/// <param name="trichordTable">A table of spacing intervals for the twelve trichords</param>
-static void nextBabbittTrichordRow(int* permutation, int trichordTable[12][12])
+void nextBabbittTrichordRow(int* permutation)
 {
-	// assume that the permutation is valid
-	int validPermutation = -1;
-
-	do
-	{
-		int criticalIndex = validPermutation;
-		int smallestRight = 0;
-		int buffer[12] = { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
-		buffer[permutation[11]] = permutation[11];
-
-		// if we don't have a critical index already, we need to find it
-		if (criticalIndex == -1 || criticalIndex > 11)
-		{
-			// Identify the index of the critical digit, as well as the smallest number
-			// Critical digit cannot be the last digit; must be index 10 or lower
-			for (int i = 10; i >= 0; i--)
-			{
-				buffer[permutation[i]] = permutation[i];
-
-				// if we have identified the critical digit
-				if (permutation[i] < permutation[i + 1])
-				{
-					smallestRight = permutation[i] + 1;
-					criticalIndex = i;
-					while (buffer[smallestRight] == -1)
-						smallestRight++;
-					permutation[i] = smallestRight;
-					buffer[smallestRight] = -1;
-					break;
-				}
-			}
-		}
-
-		// If the critical index was provided
-		else
-		{
-			for (int i = 10; i >= criticalIndex; i--)
-				buffer[permutation[i]] = permutation[i];
-			smallestRight = permutation[criticalIndex] + 1;
-			// If the critical digit is not 11, search for the smallest right
-			// digit that is larger than the critical digit
-			if (smallestRight < 12)
-			{
-				while (buffer[smallestRight] == -1)
-				{
-					smallestRight++;
-					if (smallestRight > 11)
-						break;
-				}
-			}
-			// If we were unable to find an acceptable smallest right digit,
-			// we need to find a new critical digit.
-			if (smallestRight > 11)
-			{
-				// Identify the index of the critical digit, as well as the smallest number
-				// Critical digit cannot be the last digit; must be index 10 or lower
-				for (int i = criticalIndex - 1; i >= 0; i--)
-				{
-					buffer[permutation[i]] = permutation[i];
-
-					// if we have identified the critical digit
-					if (permutation[i] < permutation[i + 1])
-					{
-						smallestRight = permutation[i] + 1;
-						criticalIndex = i;
-						while (buffer[smallestRight] == -1)
-							smallestRight++;
-						permutation[i] = smallestRight;
-						buffer[smallestRight] = -1;
-						break;
-					}
-				}
-			}
-			else
-			{
-				permutation[criticalIndex] = smallestRight;
-				buffer[smallestRight] = -1;
-			}
-		}
-
-		// Update the permutation and reset the buffer
-		smallestRight = 0;
-		for (int i = criticalIndex + 1; i < 12; i++)
-		{
-			while (buffer[smallestRight] == -1)
-				smallestRight++;
-			permutation[i] = smallestRight;
-			smallestRight++;
-		}
-		validPermutation = isValidBabbittTrichordRow(permutation, trichordTable);
-	} while (validPermutation > -1);
+	BabbittTrichordRowPredicate isValid(TRICHORD_TABLE);
+	nextRow<12, 0>(permutation, isValid);
 }
 
 /// <summary>
 /// Writes found all-trichord Babbitt rows to file
 /// </summary>
 /// <param name="path">The file to write to</param>
-/// <param name="found">A vector of found rows</param>
-static void writeBabbittTrichordRowsToFile(std::string path, std::vector<int*> found)
+/// <param name="found">An arena of found rows</param>
+void writeBabbittTrichordRowsToFile(std::string path, const RowArena& found)
 {
-	std::ofstream file;
-	file.open(path);
-	file << "{\n    \"allTrichordBabbittRows\": [\n";
-	for (int i = 0; i < found.size() - 1; i++)
-	{
-		file << "        [";
-		for (int j = 0; j < 11; j++)
-			file << found[i][j] << ", ";
-		file << found[i][11] << "],\n";
-	}
-	if (found.size() > 0)
-	{
-		file << "        [";
-		for (int j = 0; j < 11; j++)
-			file << found[found.size() - 1][j] << ", ";
-		file << found[found.size() - 1][11] << "]\n";
-	}
-	file << "    ]\n}\n";
-	file.close();
+	JsonRowWriter writer(path, "allTrichordBabbittRows", found.length());
+	for (size_t i = 0; i < found.size(); i++)
+		writer.write(found[i]);
+	writer.close();
 }
 
 #endif